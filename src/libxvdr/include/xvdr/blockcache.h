@@ -0,0 +1,164 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace XVDR {
+
+/**
+ * BlockCache class.
+ * LRU cache of recording data in chunks of ChunkSize bytes, keyed by
+ * recording id and chunk aligned offset. Chunks evicted from memory move
+ * to an optional cache file.
+ */
+class BlockCache
+{
+public:
+
+  /**
+   * Cache statistics.
+   */
+  struct Statistics {
+    uint64_t hits;          /*!< chunks found in memory */
+    uint64_t diskhits;      /*!< chunks found in the cache file */
+    uint64_t misses;        /*!< chunks which couldn't be read from the cache */
+    size_t memory;          /*!< chunks in memory */
+    size_t disk;            /*!< chunks in the cache file */
+  };
+
+  BlockCache();
+
+  ~BlockCache();
+
+  /**
+   * Set the size of the cache.
+   * Drops all cached chunks.
+   * @param memory size of the memory tier in bytes
+   * @param disk size of the disk tier in bytes (0 disables the disk tier)
+   * @param file path of the cache file
+   * @return false if the cache file couldn't be created
+   */
+  bool SetSize(size_t memory, size_t disk = 0, const std::string& file = "");
+
+  /**
+   * Check if a chunk is cached.
+   * @param recid recording id
+   * @param offset chunk aligned offset
+   */
+  bool Contains(const std::string& recid, uint64_t offset);
+
+  /**
+   * Get a chunk from the cache.
+   * @param recid recording id
+   * @param offset chunk aligned offset
+   * @param data receives ChunkSize bytes
+   * @return true if the chunk was cached
+   */
+  bool Get(const std::string& recid, uint64_t offset, uint8_t* data);
+
+  /**
+   * Put a chunk into the cache.
+   * @param recid recording id
+   * @param offset chunk aligned offset
+   * @param data ChunkSize bytes of the recording
+   */
+  void Put(const std::string& recid, uint64_t offset, const uint8_t* data);
+
+  /**
+   * Drop all cached chunks.
+   * The cache is cleared on the next access. May be called from any thread.
+   */
+  void Invalidate();
+
+  /**
+   * Get the cache statistics.
+   * @param s receives the statistics
+   */
+  void GetStatistics(Statistics& s);
+
+  enum {
+    ChunkSize = 32 * 1024           /* !< size of a cached chunk */
+  };
+
+private:
+
+  struct Key
+  {
+    std::string recid;
+    uint64_t offset;
+
+    bool operator<(const Key& rhs) const
+    {
+      return (offset != rhs.offset) ? (offset < rhs.offset) : (recid < rhs.recid);
+    }
+  };
+
+  struct Entry
+  {
+    uint8_t* data;
+    int slot;
+    std::list<Key>::iterator lru;
+  };
+
+  typedef std::map<Key, Entry> Index;
+
+  void Clear();
+
+  void Check();
+
+  void Evict();
+
+  bool Store(Entry& e);
+
+  bool Load(Entry& e, uint8_t* data);
+
+  Index m_index;
+
+  // least recently used chunks at the front
+  std::list<Key> m_memory;
+
+  std::list<Key> m_disk;
+
+  size_t m_memorychunks;
+
+  size_t m_diskchunks;
+
+  std::vector<int> m_freeslots;
+
+  std::string m_filename;
+
+  int m_fd;
+
+  bool m_invalid;
+
+  Statistics m_stats;
+};
+
+} // namespace XVDR
@@ -112,6 +112,12 @@ public:
 
   virtual void FreePacket(Packet* p) = 0;
 
+  // direct access to the payload memory of an allocated packet.
+  // if supported, payloads are received directly into the packet
+  // and SetPacketData is called with data = NULL.
+
+  virtual uint8_t* GetPacketBuffer(Packet* p);
+
   virtual Packet* StreamChange(const StreamProperties& p);
 
   // access locking
@@ -27,11 +27,13 @@
 #include "xvdr/session.h"
 #include "xvdr/thread.h"
 
+#include <deque>
 #include <string>
-#include <map>
 #include <vector>
 
 #include "xvdr/dataset.h"
+#include "xvdr/recordingindex.h"
+#include "xvdr/recordingreader.h"
 
 class MsgPacket;
 
@@ -52,6 +54,7 @@ public:
 
   void SetTimeout(int ms);
   void SetCompressionLevel(int level);
+  void SetCompressionCodec(int codec);
   void SetAudioType(int type);
 
   int                GetProtocol()   { return m_protocol; }
@@ -67,8 +70,29 @@ public:
 
   int         GetChannelsCount();
   bool        GetChannelsList(bool radio = false);
+
+  /**
+   * Get the EPG of a channel.
+   * While the calls follow the order of the channel list with the same time
+   * range, the EPG of the next channels is requested ahead, so they don't wait
+   * a round trip each.
+   * @param channeluid unique id of the channel
+   * @param start start time
+   * @param end end time
+   * @return true on success
+   */
   bool        GetEPGForChannel(uint32_t channeluid, time_t start, time_t end);
 
+  /**
+   * Get the EPG of several channels.
+   * All requests are kept in flight within the request window.
+   * @param channeluids unique ids of the channels
+   * @param start start time
+   * @param end end time
+   * @return true on success
+   */
+  bool        GetEPGForChannels(const std::vector<uint32_t>& channeluids, time_t start, time_t end);
+
   int         GetChannelGroupCount(bool automatic);
   bool        GetChannelGroupList(bool bRadio);
   bool        GetChannelGroupMembers(const std::string& groupname, bool radio);
@@ -90,6 +114,45 @@ public:
 
   MsgPacket*  ReadResult(MsgPacket* vrp);
 
+  // Asynchronous requests
+
+  /**
+   * Send a request without waiting for the response.
+   * Up to SetRequestWindow() requests may be in flight at once, further
+   * requests block until a response has been collected (or the timeout expired).
+   * @param vrp request packet
+   * @return request handle, 0 on failure
+   */
+  uint32_t    SendRequest(MsgPacket* vrp);
+
+  /**
+   * Wait for the response of a request.
+   * Every handle returned by SendRequest must be collected by WaitResponse or CancelRequest.
+   * @param handle request handle
+   * @return response packet (to be deleted by the caller), NULL on timeout or error
+   */
+  MsgPacket*  WaitResponse(uint32_t handle);
+
+  /**
+   * Check if the response of a request has been received.
+   * @param handle request handle
+   * @return true if WaitResponse will return immediately
+   */
+  bool        ResponseReady(uint32_t handle);
+
+  /**
+   * Cancel a request.
+   * Discards the response of a request and frees its slot in the request window.
+   * @param handle request handle
+   */
+  void        CancelRequest(uint32_t handle);
+
+  /**
+   * Set the maximum number of requests in flight.
+   * @param size window size
+   */
+  void        SetRequestWindow(int size);
+
   // Recordings
 
   bool OpenRecording(const std::string& recid);
@@ -99,6 +162,36 @@ public:
   long long SeekRecording(long long pos, uint32_t whence);
   long long RecordingPosition(void);
   long long RecordingLength(void);
+
+  /**
+   * Seek to the keyframe next to a frame of the recording.
+   * Keyframes are looked up on the server once, later seeks use the cached keyframe map.
+   * @param frame frame number
+   * @param backwards jump to the keyframe at or before the frame (or after the frame if false)
+   * @return new position in bytes or -1 on error
+   */
+  long long SeekRecordingFrame(uint32_t frame, bool backwards = true);
+
+  /**
+   * Seek to the keyframe next to a playback time of the recording.
+   * @param ms playback time in milliseconds
+   * @param backwards jump to the keyframe at or before the time (or after the time if false)
+   * @param fps frame rate of the recording (VDR's default is 25)
+   * @return new position in bytes or -1 on error
+   */
+  long long SeekRecordingTime(uint32_t ms, bool backwards = true, double fps = 25.0);
+
+  /**
+   * Get the frame at the current position of the recording.
+   * @return frame number or -1 on error
+   */
+  long long RecordingFrame(void);
+
+  uint32_t RecordingFrames(void);
+  void GetRecordingIndexStatistics(RecordingIndex::Statistics& s);
+  void GetRecordingStatistics(RecordingReader::Statistics& s);
+  bool SetRecordingCache(size_t memory, size_t disk = 0, const std::string& file = "");
+  void GetRecordingCacheStatistics(BlockCache::Statistics& s);
   bool LoadRecordingEdl(const std::string& recid, RecordingEdl& edl);
 
   // Channelscanner
@@ -127,13 +220,46 @@ private:
 
   bool        Login();
 
+  enum {
+    MaxRequests = 256,
+    DefaultRequestWindow = 32,
+    EpgPrefetch = 8,
+    SlotFree = 0,
+    SlotClaimed = 0xFFFFFFFE,
+    SlotDone = 0xFFFFFFFF
+  };
+
+  // pending request slot. state is the uid of the pending request,
+  // SlotFree, SlotClaimed (response is being published) or SlotDone
   struct SMessage
   {
-    CondWait* event;
-    MsgPacket* pkt;
+    volatile uint32_t state;
+    uint32_t uid;
+    uint16_t msgid;
+    MsgPacket* volatile pkt;
+    CondWait event;
+  };
+
+  // EPG request sent ahead of GetEPGForChannel
+  struct SEpgRequest
+  {
+    uint32_t channeluid;
+    time_t start;
+    time_t end;
+    uint32_t handle;
   };
-  typedef std::map<int, SMessage> SMessages;
-  SMessages m_queue;
+
+  SMessage* FindRequest(uint32_t handle);
+  SMessage* ClaimRequest(uint32_t uid);
+  void ReleaseRequest(SMessage* slot);
+
+  uint32_t SendEPGRequest(uint32_t channeluid, time_t start, time_t end);
+  bool TransferEPG(uint32_t channeluid, uint32_t handle);
+  void PrefetchEPG(const std::vector<uint32_t>& channeluids, size_t index, time_t start, time_t end);
+  void CancelEPGPrefetch();
+
+  SMessage m_slots[MaxRequests];
+  int m_pending;
 
   Mutex m_mutex;
   Mutex m_cmdlock;
@@ -146,18 +272,30 @@ private:
   std::vector<int> m_caids;
 
   std::string m_recid;
-  uint64_t m_currentPlayingRecordBytes;
-  uint64_t m_currentPlayingRecordPosition;
+  RecordingReader m_reader;
+  RecordingIndex m_index;
+
+  // channel order of the last channel lists (tv, radio), the prefetched EPG requests
+  // and the last EPG request of GetEPGForChannel
+  std::vector<uint32_t> m_channeluids[2];
+  std::deque<SEpgRequest> m_epgrequests;
+  Mutex m_epglock;
+  SEpgRequest m_epglast;
 
   std::string m_server;
   std::string m_version;
   std::string m_name;
 
   int m_compressionlevel;
+  int m_compressioncodec;
   int m_audiotype;
   int m_protocol;
   
   int m_supportsChannelScan;
+
+  int m_window;
+  CondWait m_windowevent;
+  CondWait m_abortevent;
 };
 
 } // namespace XVDR
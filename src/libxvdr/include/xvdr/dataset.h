@@ -191,11 +191,59 @@ public:
 SignalStatus& operator<< (SignalStatus& lhs, MsgPacket* rhs);
 
 
+class QueueStatus {
+public:
+
+  QueueStatus();
+  QueueStatus(MsgPacket* p);
+
+  uint32_t    ServerQueued;     // bytes queued for the client on the server
+  uint32_t    ServerCapacity;   // size of the server queue in bytes (0 = unknown)
+  uint32_t    ServerFill;       // fill level of the server queue in percent
+  uint32_t    Reports;          // number of queue status reports received
+  uint64_t    LocalQueued;      // bytes waiting for the reader
+  uint64_t    LocalCapacity;    // current size of the local buffer in bytes
+  uint32_t    Dropped;          // packets dropped because the reader didn't keep up
+  bool        Backlog;          // the server reports a backlog
+};
+
+QueueStatus& operator<< (QueueStatus& lhs, MsgPacket* rhs);
+
+
 class Stream {
 public:
 
+  typedef enum {
+    CONTENT_UNKNOWN = 0,
+    CONTENT_VIDEO = 1,
+    CONTENT_AUDIO = 2,
+    CONTENT_SUBTITLE = 3,
+    CONTENT_TELETEXT = 4
+  } ContentType;
+
+  typedef enum {
+    CODEC_UNKNOWN = 0,
+    CODEC_MPEG2VIDEO = 1,
+    CODEC_H264 = 2,
+    CODEC_MPEG2AUDIO = 3,
+    CODEC_AC3 = 4,
+    CODEC_EAC3 = 5,
+    CODEC_AAC = 6,
+    CODEC_DVBSUB = 7,
+    CODEC_TELETEXT = 8
+  } CodecId;
+
   Stream();
 
+  // resolve codec and content from the stream type
+  void SetType(const std::string& type);
+
+  static CodecId GetCodecId(const std::string& type);
+
+  static ContentType GetContentType(CodecId codec);
+
+  static const char* GetContentName(ContentType content);
+
   int         Index;
   int         Identifier;
   uint32_t    PhysicalId;
@@ -212,9 +260,80 @@ public:
   uint32_t    BitsPerSample;
   std::string Type;
   std::string Content;
+  ContentType ContentId;
+  CodecId     Codec;
+};
+
+/**
+ * Flat stream table.
+ * Maps the physical id of a stream to its index, content type and codec.
+ * The entries are stored in a small open addressing hash table, a lookup
+ * usually touches a single cache line.
+ */
+class StreamTable {
+public:
+
+  struct Entry {
+    uint32_t PhysicalId;
+    int16_t  Index;       // -1 = empty slot
+    uint8_t  Content;     // Stream::ContentType
+    uint8_t  Codec;       // Stream::CodecId
+  };
+
+  StreamTable();
+
+  void clear();
+
+  bool insert(const Stream& stream);
+
+  const Entry* find(uint32_t physicalid) const {
+    uint32_t slot = Hash(physicalid);
+
+    for(int i = 0; i < TableSize; i++, slot = (slot + 1) & (TableSize - 1)) {
+      const Entry& e = m_entries[slot];
+
+      if(e.Index == -1)
+        return NULL;
+
+      if(e.PhysicalId == physicalid)
+        return &e;
+    }
+
+    return NULL;
+  }
+
+  int size() const { return m_count; }
+
+  enum {
+    TableSize = 32      // power of 2, at least twice the maximum number of streams
+  };
+
+private:
+
+  static uint32_t Hash(uint32_t physicalid) {
+    return (physicalid * 2654435761U) >> 27;
+  }
+
+  Entry m_entries[TableSize];
+
+  int m_count;
 };
 
 class StreamProperties : public std::map<uint32_t, Stream> {
+public:
+
+  // clear streams and table
+  void clear();
+
+  // rebuild the stream table from the map
+  void UpdateTable();
+
+  // flat view of the streams, valid after UpdateTable
+  const StreamTable& GetTable() const { return m_table; }
+
+private:
+
+  StreamTable m_table;
 };
 
 bool operator==(Stream const& lhs, Stream const& rhs);
@@ -32,6 +32,7 @@
 #include "xvdr/dataset.h"
 #include "xvdr/command.h"
 #include "xvdr/packetbuffer.h"
+#include "xvdr/packetring.h"
 
 class MsgPacket;
 
@@ -84,6 +85,14 @@ public:
 	 */
 	void CloseChannel();
 
+	/**
+	 * Set the packet buffer.
+	 * Replaces (and deletes) the current packet buffer. Must not be called
+	 * while a channel is streaming.
+	 * @param buffer pointer to custom PacketBuffer object, may be NULL
+	 */
+	void SetPacketBuffer(PacketBuffer* buffer);
+
 	/**
 	 * Abort connection.
 	 * Immediately tears-down the backend connection.
@@ -104,6 +113,35 @@ public:
 		return (T*)Read();
 	}
 
+	/**
+	 * Read a packet with deadline.
+	 * Returns as soon as a packet is available.
+	 * @param timeout maximum time to wait in milliseconds
+	 * @return the next available stream packet or NULL if the deadline
+	 * expired or the connection has been closed
+	 */
+	Packet* Read(int timeout);
+
+	/**
+	 * Templatized read function with deadline.
+	 * @param timeout maximum time to wait in milliseconds
+	 * @return casted type of a packet
+	 */
+	template<class T>T* Read(int timeout) {
+		return (T*)Read(timeout);
+	}
+
+	/**
+	 * Read a batch of packets.
+	 * Waits for the first packet and returns it together with all packets
+	 * already queued (up to count).
+	 * @param packets array receiving the stream packets
+	 * @param count maximum number of packets to read (at most 64)
+	 * @param timeout maximum time to wait for the first packet in milliseconds
+	 * @return number of packets stored in the array
+	 */
+	int ReadMany(Packet** packets, int count, int timeout);
+
 	/**
 	 * Switch to a different TV channel.
 	 * Changes the channel on the backend without re-connecting.
@@ -141,6 +179,14 @@ public:
 	 */
 	SignalStatus GetSignalStatus();
 
+	/**
+	 * Get the queue status.
+	 * Returns the last queue fill level reported by the backend together
+	 * with the state of the local packet queue
+	 * @return the queue status structure
+	 */
+	QueueStatus GetQueueStatus();
+
 	/**
 	 * Pause current TV channel.
 	 * @param on true - pause channel / false - continue streaming
@@ -185,22 +231,74 @@ protected:
 
 	void StreamSignalInfo(MsgPacket* resp);
 
+	void StreamQueueStatus(MsgPacket* resp);
+
+	uint32_t GetPayloadPrefix(MsgPacket* p);
+
+	uint8_t* GetPayloadBuffer(MsgPacket* p, uint32_t length);
+
 private:
 
-	void GetContentFromType(const std::string& type, std::string& content);
+	// live stream packet, the payload may have been received into the client packet
+	struct LivePacket {
+		MsgPacket* msg;
+		Packet* packet;
+		size_t size;
+	};
 
 	void CleanupPacketQueue();
 
+	void PutLivePacket(MsgPacket* p);
+
+	void FreeLivePacket(LivePacket& p);
+
+	void DrainLiveRing();
+
+	bool RequestPacket();
+
+	int FetchPackets(LivePacket* items, int count);
+
+	bool WaitPackets(int timeout);
+
+	Packet* CreatePacket(MsgPacket* pkt, Packet* payload);
+
+	void ReleasePackets(LivePacket* items, int count);
+
+	void SetBacklog(bool on);
+
+	void ReserveBacklog();
+
 	StreamProperties mStreams;
 
 	SignalStatus mSignalStatus;
 
+	QueueStatus mQueueStatus;
+
 	int mPriority;
 
 	uint32_t mChannelUID;
 
 	PacketBuffer* mBuffer;
 
+	PacketRing<LivePacket, 4096> mLiveRing;
+
+	uint32_t mLiveFlush;
+
+	size_t mLiveQueueSize;
+
+	int mCredits;
+
+	uint64_t mCreditTime;
+
+	uint32_t mBacklog;
+
+	uint32_t mLiveDropped;
+
+	// size of the packetbuffer including the backlog reserve
+	size_t mBufferSize;
+
+	LivePacket mPending;
+
 	Mutex mLock;
 
 	CondWait mCondition;
@@ -214,6 +312,20 @@ private:
 	bool mIFrameStart;
 
 	bool mCanSeekStream;
+
+	enum {
+		LiveQueueSize = 10 * 1024 * 1024,	/* !< maximum size of the live packet queue */
+		BacklogQueueSize = 20 * 1024 * 1024,	/* !< maximum size of the live packet queue if the server reports a backlog */
+		BacklogReserve = 20,				/* !< packetbuffer space (percent) only used while the server reports a backlog */
+		BacklogHighWater = 50,				/* !< server queue fill level (percent) entering backlog mode */
+		BacklogLowWater = 20,				/* !< server queue fill level (percent) leaving backlog mode */
+		ReadBatchSize = 64,					/* !< maximum number of packets returned by ReadMany */
+		RequestWindow = 64,					/* !< packets requested ahead in timeshift mode */
+		BacklogRequestWindow = 256,			/* !< packets requested ahead in timeshift mode while catching up */
+		RequestLowWater = 16,				/* !< queued + requested packets triggering a new request */
+		CreditTimeout = 1000,				/* !< requests not answered within this time are considered lost */
+		MuxHeaderLength = 26				/* !< id, pts, dts, duration and length of a MUXPKT */
+	};
 };
 
 } // namespace XVDR
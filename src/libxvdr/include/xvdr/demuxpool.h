@@ -0,0 +1,149 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <string>
+#include <deque>
+
+#include "xvdr/demux.h"
+#include "xvdr/thread.h"
+
+namespace XVDR {
+
+class ClientInterface;
+class PacketBuffer;
+
+/**
+ * DemuxPool class.
+ * Keeps logged-in standby demuxers ready for channel switches and
+ * tears down released demuxers in the background.
+ */
+class DemuxPool : public Thread {
+public:
+
+	/**
+	 * DemuxPool constructor.
+	 * @param client pointer to client callback interface
+	 * @param size number of standby demuxers to keep connected
+	 */
+	DemuxPool(ClientInterface* client, int size = 1);
+
+	virtual ~DemuxPool();
+
+	/**
+	 * Start keeping standby demuxers.
+	 * Standby connections are established in the background. Changing the
+	 * server or client name drops all existing standby demuxers.
+	 * @param hostname IP-Address or hostname of the backend to connect to
+	 * @param clientname optional name of the demux client
+	 */
+	void Open(const std::string& hostname, const std::string& clientname = "");
+
+	/**
+	 * Stop keeping standby demuxers.
+	 * Releases all standby demuxers.
+	 */
+	void Close();
+
+	/**
+	 * Claim a standby demuxer.
+	 * The returned demuxer is logged in but doesn't stream a channel yet,
+	 * use Demux::SwitchChannel to start streaming.
+	 * @param buffer optional PacketBuffer object passed to the demuxer
+	 * @return connected demuxer or NULL if no standby demuxer is ready
+	 * (the caller keeps the ownership of the buffer in this case)
+	 */
+	Demux* Claim(PacketBuffer* buffer = NULL);
+
+	/**
+	 * Release a demuxer.
+	 * Closes and deletes the demuxer in the background.
+	 * @param demux demuxer to release (may be NULL)
+	 */
+	void Release(Demux* demux);
+
+	/**
+	 * Set the timeout of standby demuxers.
+	 * @param ms timeout in milliseconds
+	 */
+	void SetTimeout(int ms);
+
+	/**
+	 * Set the preferred audio type of standby demuxers.
+	 * Standby demuxers logged in with a different audio type are dropped.
+	 * @param type audio type
+	 */
+	void SetAudioType(int type);
+
+	/**
+	 * Get number of standby demuxers ready to be claimed.
+	 * @return number of standby demuxers
+	 */
+	int GetStandbyCount();
+
+protected:
+
+	void Action();
+
+	/**
+	 * Create a demuxer.
+	 * Called on the pool thread for new standby connections.
+	 * @return new demuxer object
+	 */
+	virtual Demux* CreateDemux();
+
+private:
+
+	void RetireStandby();
+
+	ClientInterface* mClient;
+
+	std::deque<Demux*> mStandby;
+
+	std::deque<Demux*> mRetired;
+
+	std::string mHostname;
+
+	std::string mClientName;
+
+	int mSize;
+
+	int mTimeout;
+
+	int mAudioType;
+
+	uint32_t mGeneration;
+
+	TimeMs mRetry;
+
+	Mutex mLock;
+
+	CondWait mEvent;
+
+	enum {
+		RetryInterval = 5000		/* !< delay before reconnecting after a failed standby connection */
+	};
+};
+
+} // namespace XVDR
@@ -79,6 +79,17 @@ public:
 	*/
 	~MsgPacket();
 
+	/**
+	Allocate a packet object.
+	Packet objects are recycled through the MsgPacketPool.
+	*/
+	static void* operator new(size_t size);
+
+	/**
+	Release a packet object to the MsgPacketPool.
+	*/
+	static void operator delete(void* p, size_t size);
+
 	/**
 	Insert NULL terminated string.
 	Add a NULL terminted string to the payload of the packet.
@@ -417,24 +428,54 @@ public:
 	*/
 	void setType(uint16_t type);
 
+	/**
+	Compression codecs.
+	The codec isn't stored in the packet, it has to be negotiated between the endpoints.
+	*/
+	typedef enum {
+		CODEC_ZLIB = 0,		/*!< zlib (deflate) */
+		CODEC_LZ4 = 1,		/*!< LZ4, fast decoding */
+		CODEC_ZSTD = 2,		/*!< Zstandard, high compression ratio */
+		CODEC_COUNT = 3
+	} Codec;
+
 	/**
 	Compress packet.
 	Compress the payload of the packet
 
-	@param level compression level (1 - 9)
+	@param level compression level (1 - 9, ignored by lz4)
+	@param codec compression codec
 	@return true on success
 	*/
-	bool compress(int level);
+	bool compress(int level, Codec codec = CODEC_ZLIB);
 
 	bool isCompressed();
 
 	/**
 	Uncompress packet.
-	Uncompress the payload of the packet
+	Uncompress the payload of the packet. Payloads announcing more than
+	MaxUncompressedPayloadLength bytes are rejected.
 
+	@param codec compression codec used to compress the packet
 	@return true on success
 	*/
-	bool uncompress();
+	bool uncompress(Codec codec = CODEC_ZLIB);
+
+	/**
+	Check codec support.
+
+	@param codec compression codec
+	@return true if the codec has been compiled in
+	*/
+	static bool isCodecSupported(Codec codec);
+
+	/**
+	Get the name of a codec.
+
+	@param codec compression codec
+	@return name of the codec
+	*/
+	static const char* getCodecName(Codec codec);
 
 	void print();
 
@@ -470,6 +511,18 @@ public:
 
 	static bool readstream(std::istream& in, MsgPacket& p);
 
+	/**
+	Create packet on serialized data.
+	The packet refers to the serialized packet (header and payload) without
+	copying it. The memory has to stay valid for the lifetime of the packet,
+	writing to the packet copies the data first. Checksums are not validated
+
+	@param	data		serialized packet
+	@param	length		length of the serialized packet in bytes
+	@return pointer to new packet or NULL on error
+	*/
+	static MsgPacket* attach(uint8_t* data, uint32_t length);
+
 	enum {
 		HeaderLength = 32,						/*!< Length (in bytes) of a packet header. */
 		CheckSumPos = 28,						/*!< Checksum position (uint32_t) within the header data. */
@@ -523,8 +576,9 @@ private:
 
 	bool checkPacketSize(uint32_t bytes);
 
+	void releaseBuffer();
+
 	static uint32_t globalUID;
-	static uint32_t crc32_tab[];
 
 	uint8_t* m_packet;
 	uint32_t m_size;
@@ -533,10 +587,12 @@ private:
 
 	bool m_freezed;
 	bool m_payloadchecksum;
+	bool m_attached;
 
 	enum {
 		InitialPacketSize = 128,
-		IncrementPacketSize = 512
+		IncrementPacketSize = 512,
+		MaxUncompressedPayloadLength = 16 * 1024 * 1024	/*!< largest accepted payload of a compressed packet */
 	};
 };
 
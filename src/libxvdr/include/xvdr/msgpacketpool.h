@@ -0,0 +1,114 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/** \file msgpacketpool.h
+	Header file for the MsgPacketPool class.
+	This include file defines the MsgPacketPool class
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+	@short Message Packet memory pool
+
+	Size-classed pool of memory blocks used for packet buffers and packet objects.
+	Blocks returned to the pool are recycled by subsequent requests of the same
+	size class, so steady-state streaming doesn't hit the heap allocator.
+*/
+
+class MsgPacketPool {
+public:
+
+	/**
+	Pool statistics.
+	*/
+	struct Statistics {
+		uint64_t hits;				/*!< requests served from the pool */
+		uint64_t misses;			/*!< requests served by the heap allocator */
+		uint64_t returns;			/*!< blocks returned to the pool */
+		uint64_t discards;			/*!< blocks freed because the pool was full */
+		uint64_t cached;			/*!< bytes currently held by the pool */
+	};
+
+	/**
+	Acquire a memory block.
+	Returns a block of the size class matching "size".
+
+	@param	size		minimum size of the block in bytes
+	@param	capacity	returns the real size of the block (may be NULL)
+	@return pointer to the memory block or NULL if allocation failed
+	*/
+	static void* acquire(uint32_t size, uint32_t* capacity = NULL);
+
+	/**
+	Release a memory block.
+	Returns a block to the pool (or frees it if the pool is full).
+
+	@param	block		pointer to the memory block (may be NULL)
+	@param	capacity	size of the block as returned by acquire
+	*/
+	static void release(void* block, uint32_t capacity);
+
+	/**
+	Get the size class.
+	Returns the size of the block which would be returned for a request.
+
+	@param	size		requested size in bytes
+	@return size of the memory block
+	*/
+	static uint32_t capacity(uint32_t size);
+
+	/**
+	Get pool statistics.
+
+	@param	stats		structure receiving the current statistics
+	*/
+	static void getStatistics(Statistics& stats);
+
+	/**
+	Reset the hit / miss counters.
+	*/
+	static void resetStatistics();
+
+	/**
+	Set the pool limit.
+	Blocks returned to a pool exceeding this limit will be freed.
+
+	@param	bytes		maximum number of bytes held by the pool
+	*/
+	static void setLimit(size_t bytes);
+
+	/**
+	Free all pooled memory blocks.
+	*/
+	static void clear();
+
+	enum {
+		MinClassShift = 5,			/*!< smallest size class (32 bytes) */
+		MaxClassShift = 22,			/*!< largest pooled size class (4 MB) */
+		DefaultLimit = 32 * 1024 * 1024	/*!< default pool limit */
+	};
+};
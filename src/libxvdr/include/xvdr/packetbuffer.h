@@ -27,6 +27,8 @@
 #ifndef XVDR_PACKETBUFFER_H
 #define XVDR_PACKETBUFFER_H
 
+#include <string.h>
+
 #include "xvdr/msgpacket.h"
 
 namespace XVDR {
@@ -35,6 +37,21 @@ class PacketBuffer {
 
 public:
 
+  /**
+   * Writer statistics of file backed buffers.
+   */
+  struct Statistics {
+    uint64_t writes;        /*!< number of write batches */
+    uint64_t written;       /*!< bytes written to the file */
+    uint64_t latency;       /*!< sum of the batch write latencies in microseconds */
+    uint64_t maxlatency;    /*!< maximum batch write latency in microseconds */
+    uint64_t stalls;        /*!< number of puts waiting for the writer */
+    uint64_t errors;        /*!< number of failed writes */
+    size_t queued;          /*!< packets waiting to be written */
+    size_t queuedbytes;     /*!< bytes waiting to be written */
+    size_t maxqueued;       /*!< maximum number of packets waiting to be written */
+  };
+
   virtual ~PacketBuffer(){}
 
   /**
@@ -43,6 +60,7 @@ public:
    * @param max_size  Maximum buffer size in bytes.
    * @param file      Path to a file to store buffer data in.
    *                  If omitted or empty - in-memory storage will be used.
+   * @return the new buffer or NULL if the memory or the file couldn't be allocated
    */
   static PacketBuffer* create(size_t max_size, const std::string& file = "");
 
@@ -81,6 +99,14 @@ public:
    */
   virtual size_t count() = 0;
 
+  /**
+   * Get the writer statistics.
+   * Buffers without a writer return zeroed statistics.
+   */
+  virtual void getStatistics(Statistics& s) {
+    memset(&s, 0, sizeof(s));
+  }
+
   /**
    * Set maximum buffer size in bytes.
    */
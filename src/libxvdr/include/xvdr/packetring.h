@@ -0,0 +1,173 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/** \file packetring.h
+	Header file for the PacketRing class.
+	The queue used to pass live packets from the receiving thread to the reader.
+*/
+
+#include <stdint.h>
+
+#include "xvdr/thread.h"
+
+namespace XVDR {
+
+/**
+	@short Single producer / single consumer ring
+
+	Bounded ring of N items (N must be a power of 2). One thread may push
+	while another thread pops, neither side takes a lock. The consumer can
+	sleep on a CondWait, which the producer only signals if the consumer is
+	actually waiting.
+
+	Positions are free running 32bit counters, the position of an item
+	identifies it until the counter wraps.
+*/
+
+template<class T, uint32_t N>
+class PacketRing {
+public:
+
+	PacketRing() : m_head(0), m_sleeping(0), m_tail(0) {
+	}
+
+	/**
+	Push an item (producer).
+
+	@param	item		item to append
+	@return false if the ring is full
+	*/
+	bool push(const T& item) {
+		uint32_t tail = m_tail;
+
+		if(tail - __atomic_load_n(&m_head, __ATOMIC_ACQUIRE) >= N) {
+			return false;
+		}
+
+		m_items[tail & (N - 1)] = item;
+		__atomic_store_n(&m_tail, tail + 1, __ATOMIC_RELEASE);
+
+		return true;
+	}
+
+	/**
+	Pop an item (consumer).
+
+	@param	item		receives the oldest item
+	@param	position	receives the position of the item (may be NULL)
+	@return false if the ring is empty
+	*/
+	bool pop(T& item, uint32_t* position = NULL) {
+		uint32_t head = m_head;
+
+		if(head == __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE)) {
+			return false;
+		}
+
+		item = m_items[head & (N - 1)];
+
+		if(position != NULL) {
+			*position = head;
+		}
+
+		__atomic_store_n(&m_head, head + 1, __ATOMIC_RELEASE);
+
+		return true;
+	}
+
+	/**
+	Check if the ring is empty.
+	*/
+	bool empty() {
+		return (__atomic_load_n(&m_head, __ATOMIC_ACQUIRE) == __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE));
+	}
+
+	/**
+	Number of queued items.
+	*/
+	uint32_t size() {
+		uint32_t head = __atomic_load_n(&m_head, __ATOMIC_ACQUIRE);
+		return __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE) - head;
+	}
+
+	/**
+	Position of the next item pushed.
+	*/
+	uint32_t tail() {
+		return __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE);
+	}
+
+	/**
+	Wait for items (consumer).
+
+	@param	event		event signaled by wakeup()
+	@param	timeout_ms	maximum time to wait in milliseconds
+	@return true if the ring isn't empty
+	*/
+	bool wait(CondWait& event, int timeout_ms) {
+		__atomic_store_n(&m_sleeping, 1, __ATOMIC_SEQ_CST);
+
+		if(empty()) {
+			event.Wait(timeout_ms);
+		}
+
+		__atomic_store_n(&m_sleeping, 0, __ATOMIC_RELEASE);
+
+		return !empty();
+	}
+
+	/**
+	Wake up a waiting consumer (producer).
+	Must be called after push, signals the event only if the consumer sleeps.
+
+	@param	event		event passed to wait()
+	*/
+	void wakeup(CondWait& event) {
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+		if(__atomic_load_n(&m_sleeping, __ATOMIC_ACQUIRE) && __sync_bool_compare_and_swap(&m_sleeping, 1, 0)) {
+			event.Signal();
+		}
+	}
+
+	enum {
+		Capacity = N				/*!< number of items the ring can hold */
+	};
+
+private:
+
+	T m_items[N];
+
+	// consumer and producer positions live in different cache lines
+	uint32_t m_head;
+
+	uint32_t m_sleeping;
+
+	uint8_t m_padding[56];
+
+	uint32_t m_tail;
+};
+
+} // namespace XVDR
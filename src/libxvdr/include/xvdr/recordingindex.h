@@ -0,0 +1,135 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+namespace XVDR {
+
+class Connection;
+
+/**
+ * RecordingIndex class.
+ * Keyframe map of recordings. Keyframes are looked up on the server
+ * (XVDR_RECSTREAM_GETIFRAME) and kept per recording, together with the
+ * range of frames known to follow each keyframe. Later lookups within
+ * a known range are answered locally.
+ */
+class RecordingIndex
+{
+public:
+
+  /**
+   * Keyframe of a recording.
+   */
+  struct KeyFrame {
+    uint32_t frame;         /*!< frame number */
+    uint64_t position;      /*!< byte position in the recording */
+    uint32_t length;        /*!< length of the frame in bytes */
+  };
+
+  /**
+   * Index statistics.
+   */
+  struct Statistics {
+    uint64_t lookups;       /*!< number of keyframe lookups */
+    uint64_t requests;      /*!< lookups sent to the server */
+    size_t keyframes;       /*!< number of known keyframes */
+  };
+
+  /**
+   * RecordingIndex constructor.
+   * @param connection connection used for the lookups
+   */
+  RecordingIndex(Connection* connection);
+
+  /**
+   * Get the keyframe next to a frame.
+   * @param recid id of the currently opened recording
+   * @param frame frame number
+   * @param backwards search the keyframe at or before the frame (or after the frame if false)
+   * @param keyframe receives the keyframe
+   * @return false if no keyframe was found
+   */
+  bool GetKeyFrame(const std::string& recid, uint32_t frame, bool backwards, KeyFrame& keyframe);
+
+  /**
+   * Get the byte position of a frame (XVDR_RECSTREAM_FRAMETOPOS).
+   * @param frame frame number
+   * @return byte position or -1 on error
+   */
+  int64_t FrameToPosition(uint32_t frame);
+
+  /**
+   * Get the frame at a byte position (XVDR_RECSTREAM_POSTOFRAME).
+   * @param position byte position
+   * @return frame number or -1 on error
+   */
+  int64_t PositionToFrame(uint64_t position);
+
+  /**
+   * Drop all keyframe maps.
+   * The maps are cleared on the next lookup. May be called from any thread.
+   */
+  void Invalidate();
+
+  /**
+   * Get the index statistics.
+   * @param recid recording id
+   * @param s receives the statistics
+   */
+  void GetStatistics(const std::string& recid, Statistics& s);
+
+private:
+
+  // keyframe, followed by "following" frames which are no keyframes
+  struct Entry
+  {
+    uint64_t position;
+    uint32_t length;
+    uint32_t following;
+  };
+
+  typedef std::map<uint32_t, Entry> KeyFrames;
+
+  bool Lookup(KeyFrames& keyframes, uint32_t frame, bool backwards, KeyFrame& keyframe);
+
+  bool Request(uint32_t frame, bool backwards, KeyFrame& keyframe);
+
+  void Add(KeyFrames& keyframes, const KeyFrame& keyframe, uint32_t frame, bool backwards);
+
+  Connection* m_connection;
+
+  std::map<std::string, KeyFrames> m_recordings;
+
+  bool m_invalid;
+
+  uint64_t m_lookups;
+
+  uint64_t m_requests;
+};
+
+} // namespace XVDR
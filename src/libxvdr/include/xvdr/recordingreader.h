@@ -0,0 +1,261 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+
+#include "xvdr/blockcache.h"
+#include "xvdr/thread.h"
+
+class MsgPacket;
+
+namespace XVDR {
+
+class Connection;
+
+/**
+ * RecordingReader class.
+ * Reads the currently opened recording of a connection. Keeps several
+ * GETBLOCK requests in flight ahead of the read position, reads are served
+ * from the received blocks. Block size and number of blocks in flight
+ * follow the measured bandwidth delay product of the connection.
+ * Received data is kept in a block cache, so seeking back doesn't request
+ * it again.
+ */
+class RecordingReader
+{
+public:
+
+  /**
+   * Transfer statistics.
+   */
+  struct Statistics {
+    uint64_t bytes;         /*!< bytes received */
+    uint64_t blocks;        /*!< number of received blocks */
+    uint64_t stalls;        /*!< number of blocks the reader had to wait for */
+    uint64_t cached;        /*!< bytes read from the block cache */
+    uint32_t rtt;           /*!< smoothed block round trip time in milliseconds */
+    uint32_t minrtt;        /*!< minimum block round trip time in milliseconds */
+    double rate;            /*!< measured throughput in MB/s */
+    uint32_t blocksize;     /*!< current block size in bytes */
+    uint32_t depth;         /*!< current number of blocks in flight */
+  };
+
+  /**
+   * RecordingReader constructor.
+   * @param connection connection used to request the blocks
+   */
+  RecordingReader(Connection* connection);
+
+  ~RecordingReader();
+
+  /**
+   * Start reading a recording.
+   * Must be called after the recording has been opened on the server.
+   * @param recid recording id
+   * @param frames number of frames of the recording
+   * @param length length of the recording in bytes
+   */
+  void Open(const std::string& recid, uint32_t frames, uint64_t length);
+
+  /**
+   * Stop reading.
+   * Cancels all requests in flight.
+   */
+  void Close();
+
+  /**
+   * Read from the current position.
+   * Waits only if no data of the current position has been received yet.
+   * @param buffer buffer receiving the data
+   * @param size size of the buffer in bytes
+   * @return number of bytes read, 0 at the end of the recording, -1 on error
+   */
+  int Read(uint8_t* buffer, uint32_t size);
+
+  /**
+   * Set the read position.
+   * Blocks ahead of the new position are kept, all others are dropped.
+   * @param position new read position
+   */
+  void Seek(uint64_t position);
+
+  /**
+   * Get the read position.
+   * @return current read position in bytes
+   */
+  uint64_t GetPosition();
+
+  /**
+   * Get the length of the recording.
+   * @return last known length of the recording in bytes
+   */
+  uint64_t GetLength();
+
+  /**
+   * Get the number of frames of the recording.
+   * @return last known number of frames
+   */
+  uint32_t GetFrames();
+
+  /**
+   * Notify about changed recordings.
+   * Forces a length update on the next read. May be called from any thread.
+   */
+  void RecordingsChanged();
+
+  /**
+   * Get the transfer statistics.
+   * @param s receives the statistics
+   */
+  void GetStatistics(Statistics& s);
+
+  /**
+   * Set the size of the block cache.
+   * @param memory size of the memory tier in bytes
+   * @param disk size of the disk tier in bytes (0 disables the disk tier)
+   * @param file path of the cache file
+   * @return false if the cache file couldn't be created
+   */
+  bool SetCacheSize(size_t memory, size_t disk = 0, const std::string& file = "");
+
+  /**
+   * Get the block cache statistics.
+   * @param s receives the statistics
+   */
+  void GetCacheStatistics(BlockCache::Statistics& s);
+
+private:
+
+  // requested range of the recording
+  struct Block
+  {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t handle;
+    MsgPacket* data;
+    TimeMs sent;
+    uint32_t read;
+  };
+
+  void Fill();
+
+  void Reset();
+
+  void DropBlock();
+
+  bool FillCached();
+
+  void Cache(Block& b);
+
+  bool Receive(Block& b);
+
+  void Adapt(uint32_t rtt, bool stalled);
+
+  void UpdateLength(bool wait);
+
+  uint32_t UpdateInterval();
+
+  Connection* m_connection;
+
+  BlockCache m_cache;
+
+  std::string m_recid;
+
+  std::deque<Block> m_blocks;
+
+  uint64_t m_position;
+
+  uint64_t m_length;
+
+  uint32_t m_frames;
+
+  // end of the requested range
+  uint64_t m_requested;
+
+  // pending length update
+  uint32_t m_update;
+
+  TimeMs m_lastupdate;
+
+  // the recording is still running
+  bool m_growing;
+
+  bool m_changed;
+
+  bool m_open;
+
+  // bytes to keep in flight
+  uint32_t m_window;
+
+  uint32_t m_blocksize;
+
+  uint32_t m_depth;
+
+  // size of the next block after a seek
+  uint32_t m_ramp;
+
+  // bytes requested ahead of the position (ramps up to m_window after a seek)
+  uint32_t m_ahead;
+
+  // smoothed and minimum round trip time (ms)
+  uint32_t m_srtt;
+
+  uint32_t m_minrtt;
+
+  TimeMs m_minrtttimer;
+
+  // throughput (bytes per second)
+  double m_rate;
+
+  uint64_t m_ratebytes;
+
+  TimeMs m_ratetimer;
+
+  // number of the current read
+  uint32_t m_reads;
+
+  Statistics m_stats;
+
+  enum {
+    MinBlockSize = 32 * 1024,     /* !< minimum size of a requested block */
+    MaxBlockSize = 1024 * 1024,   /* !< maximum size of a requested block */
+    MinDepth = 2,                 /* !< minimum number of blocks in flight */
+    MaxDepth = 16,                /* !< maximum number of blocks in flight */
+    TargetDepth = 4,              /* !< number of blocks the window is split into */
+    InitialWindow = 512 * 1024,   /* !< bytes in flight after opening a recording */
+    MinWindow = 128 * 1024,       /* !< minimum number of bytes in flight */
+    MaxWindow = 16 * 1024 * 1024, /* !< maximum number of bytes in flight */
+    RateInterval = 250,           /* !< throughput sampling interval (ms) */
+    MinRttInterval = 10000,       /* !< lifetime of the minimum round trip time (ms) */
+    QueueDelay = 5,               /* !< round trip time increase considered as queueing (ms) */
+    FinishedInterval = 10000,     /* !< length update interval of a finished recording (ms) */
+    GrowingInterval = 1000,       /* !< length update interval of a running recording (ms) */
+    CacheSize = 32 * 1024 * 1024  /* !< default size of the block cache in memory */
+  };
+};
+
+} // namespace XVDR
@@ -27,14 +27,19 @@
 #include <stdint.h>
 #include <string>
 
+#include "xvdr/thread.h"
+
 class MsgPacket;
 
 namespace XVDR {
 
 class Callbacks;
+class PacketReader;
 
 class Session
 {
+  friend class PacketReader;
+
 public:
 
   Session();
@@ -51,6 +56,9 @@ public:
 
   bool TransmitMessage(MsgPacket* vrp);
 
+  // transmit a packet multiple times with a single write
+  bool TransmitMessage(MsgPacket* vrp, int count);
+
   MsgPacket* ReadResult(MsgPacket* vrp);
 
   bool ConnectionLost();
@@ -67,6 +75,24 @@ protected:
 
   virtual void SignalConnectionLost();
 
+  /**
+   * Direct payload reception.
+   * Called on the receiving thread when the header of a packet has been read.
+   * @param p packet containing the header only
+   * @return number of leading payload bytes to receive into the packet
+   * before GetPayloadBuffer is called, 0 receives the whole payload into the packet
+   */
+  virtual uint32_t GetPayloadPrefix(MsgPacket* p);
+
+  /**
+   * Get memory for the remaining payload.
+   * Called on the receiving thread when the payload prefix has been read.
+   * @param p packet containing the header and the payload prefix
+   * @param length number of remaining payload bytes
+   * @return memory receiving the remaining payload, NULL to receive it into the packet
+   */
+  virtual uint8_t* GetPayloadBuffer(MsgPacket* p, uint32_t length);
+
   std::string m_hostname;
 
   int m_port;
@@ -75,14 +101,24 @@ protected:
 
   bool m_connectionLost;
 
+  int m_codec;
+
 private:
 
   int OpenSocket(const std::string& hostname, int port);
 
   bool readData(uint8_t* buffer, int totalBytes);
 
+  bool writeData(const uint8_t* buffer, int totalBytes);
+
   int m_fd;
 
+  PacketReader* m_reader;
+
+  int m_wakeup[2];
+
+  Mutex m_writelock;
+
   /*struct streamPacketHeader;
 
   struct streamPacketHeader* m_streamPacketHeader;
@@ -0,0 +1,249 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "xvdr/blockcache.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+using namespace XVDR;
+
+BlockCache::BlockCache()
+ : m_memorychunks(0)
+ , m_diskchunks(0)
+ , m_fd(-1)
+ , m_invalid(false)
+{
+  memset(&m_stats, 0, sizeof(m_stats));
+}
+
+BlockCache::~BlockCache()
+{
+  SetSize(0);
+}
+
+bool BlockCache::SetSize(size_t memory, size_t disk, const std::string& file)
+{
+  if(m_fd != -1)
+  {
+    close(m_fd);
+    unlink(m_filename.c_str());
+    m_fd = -1;
+  }
+
+  m_memorychunks = memory / ChunkSize;
+  m_diskchunks = 0;
+  m_filename.clear();
+
+  if(disk >= ChunkSize && !file.empty())
+  {
+    m_fd = open(file.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_BINARY, 0644);
+
+    if(m_fd != -1)
+    {
+      m_filename = file;
+      m_diskchunks = disk / ChunkSize;
+    }
+  }
+
+  Clear();
+
+  return (disk < ChunkSize || file.empty() || m_fd != -1);
+}
+
+void BlockCache::Clear()
+{
+  for(Index::iterator i = m_index.begin(); i != m_index.end(); i++)
+    delete[] i->second.data;
+
+  m_index.clear();
+  m_memory.clear();
+  m_disk.clear();
+  m_freeslots.clear();
+
+  for(int i = (int)m_diskchunks - 1; i >= 0; i--)
+    m_freeslots.push_back(i);
+}
+
+void BlockCache::Check()
+{
+  if(__atomic_exchange_n(&m_invalid, false, __ATOMIC_ACQ_REL))
+    Clear();
+}
+
+void BlockCache::Invalidate()
+{
+  __atomic_store_n(&m_invalid, true, __ATOMIC_RELEASE);
+}
+
+bool BlockCache::Contains(const std::string& recid, uint64_t offset)
+{
+  Check();
+
+  Key key;
+  key.recid = recid;
+  key.offset = offset;
+
+  return (m_index.find(key) != m_index.end());
+}
+
+bool BlockCache::Get(const std::string& recid, uint64_t offset, uint8_t* data)
+{
+  Check();
+
+  Key key;
+  key.recid = recid;
+  key.offset = offset;
+
+  Index::iterator i = m_index.find(key);
+
+  if(i == m_index.end())
+  {
+    m_stats.misses++;
+    return false;
+  }
+
+  Entry& e = i->second;
+
+  if(e.data != NULL)
+  {
+    memcpy(data, e.data, ChunkSize);
+    m_memory.splice(m_memory.end(), m_memory, e.lru);
+    m_stats.hits++;
+    return true;
+  }
+
+  if(!Load(e, data))
+  {
+    m_disk.erase(e.lru);
+    m_index.erase(i);
+    m_stats.misses++;
+    return false;
+  }
+
+  m_disk.splice(m_disk.end(), m_disk, e.lru);
+  m_stats.diskhits++;
+  return true;
+}
+
+void BlockCache::Put(const std::string& recid, uint64_t offset, const uint8_t* data)
+{
+  Check();
+
+  if(m_memorychunks == 0)
+    return;
+
+  Key key;
+  key.recid = recid;
+  key.offset = offset;
+
+  if(m_index.find(key) != m_index.end())
+    return;
+
+  while(m_memory.size() >= m_memorychunks)
+    Evict();
+
+  Entry e;
+  e.data = new uint8_t[ChunkSize];
+  e.slot = -1;
+  e.lru = m_memory.insert(m_memory.end(), key);
+
+  memcpy(e.data, data, ChunkSize);
+
+  m_index[key] = e;
+}
+
+void BlockCache::Evict()
+{
+  Index::iterator i = m_index.find(m_memory.front());
+  Entry& e = i->second;
+
+  m_memory.pop_front();
+
+  // move the chunk to the cache file
+  if(m_diskchunks > 0)
+  {
+    if(m_freeslots.empty())
+    {
+      Index::iterator d = m_index.find(m_disk.front());
+      m_freeslots.push_back(d->second.slot);
+      m_disk.pop_front();
+      m_index.erase(d);
+    }
+
+    if(Store(e))
+    {
+      e.lru = m_disk.insert(m_disk.end(), i->first);
+      return;
+    }
+  }
+
+  delete[] e.data;
+  m_index.erase(i);
+}
+
+bool BlockCache::Store(Entry& e)
+{
+  int slot = m_freeslots.back();
+  off_t position = (off_t)slot * ChunkSize;
+
+  if(lseek(m_fd, position, SEEK_SET) == -1 || write(m_fd, e.data, ChunkSize) != ChunkSize)
+    return false;
+
+  m_freeslots.pop_back();
+
+  delete[] e.data;
+  e.data = NULL;
+  e.slot = slot;
+
+  return true;
+}
+
+bool BlockCache::Load(Entry& e, uint8_t* data)
+{
+  off_t position = (off_t)e.slot * ChunkSize;
+
+  if(lseek(m_fd, position, SEEK_SET) == -1 || read(m_fd, data, ChunkSize) != ChunkSize)
+  {
+    m_freeslots.push_back(e.slot);
+    return false;
+  }
+
+  return true;
+}
+
+void BlockCache::GetStatistics(Statistics& s)
+{
+  s = m_stats;
+  s.memory = m_memory.size();
+  s.disk = m_disk.size();
+}
@@ -89,6 +89,10 @@ Packet* ClientInterface::StreamChange(const StreamProperties& p) {
 	return NULL;
 }
 
+uint8_t* ClientInterface::GetPacketBuffer(Packet* /*p*/) {
+	return NULL;
+}
+
 void ClientInterface::OnDisconnect() {
   Log(FAILURE, "connection lost!");
 }
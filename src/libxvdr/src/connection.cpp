@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <algorithm>
 
 #include "xvdr/connection.h"
 #include "xvdr/clientinterface.h"
@@ -44,17 +45,31 @@ Connection::Connection(ClientInterface* client)
  , m_timercount(0)
  , m_updatechannels(2)
  , m_client(client)
+ , m_pending(0)
+ , m_reader(this)
+ , m_index(this)
+ , m_epglast()
  , m_protocol(0)
  , m_compressionlevel(0)
+ , m_compressioncodec(MsgPacket::CODEC_ZLIB)
  , m_audiotype(0)
  , m_supportsChannelScan(0)
+ , m_window(DefaultRequestWindow)
 {
+  for(uint32_t i = 0; i < MaxRequests; i++)
+  {
+    m_slots[i].state = SlotFree;
+    m_slots[i].uid = 0;
+    m_slots[i].msgid = 0;
+    m_slots[i].pkt = NULL;
+  }
 }
 
 Connection::~Connection()
 {
   Abort();
   Cancel(1);
+  CancelEPGPrefetch();
   Close();
 }
 
@@ -96,6 +111,10 @@ bool Connection::Login()
   vrp.put_String((lang != NULL) ? lang : "");
   vrp.put_U8(m_audiotype);
 
+  // preferred compression codec (servers supporting zlib only ignore this)
+  if (m_compressionlevel > 0 && m_compressioncodec != MsgPacket::CODEC_ZLIB)
+    vrp.put_U8(m_compressioncodec);
+
   // read welcome
   MsgPacket* vresp = Session::ReadResult(&vrp);
   if (!vresp)
@@ -110,9 +129,25 @@ bool Connection::Login()
   m_server                  = vresp->get_String();
   m_version                 = vresp->get_String();
 
+  // codec selected by the server (zlib if missing)
+  m_codec = MsgPacket::CODEC_ZLIB;
+
+  if (!vresp->eop())
+  {
+    MsgPacket::Codec codec = (MsgPacket::Codec)vresp->get_U8();
+
+    if (MsgPacket::isCodecSupported(codec))
+      m_codec = codec;
+    else
+      m_client->Log(FAILURE, "server selected unsupported compression codec %i", codec);
+  }
+
   m_client->Log(INFO, "Logged in at '%u+%i' to '%s' Version: '%s' with protocol version '%u'", vdrTime, vdrTimeOffset, m_server.c_str(), m_version.c_str(), m_protocol);
   m_client->Log(INFO, "Preferred Audio Language: %s", lang);
 
+  if (m_compressionlevel > 0)
+    m_client->Log(INFO, "Compression: %s (level %i)", MsgPacket::getCodecName((MsgPacket::Codec)m_codec), m_compressionlevel);
+
   delete vresp;
   return true;
 }
@@ -122,6 +157,7 @@ void Connection::Abort()
   MutexLock lock(&m_mutex);
   m_aborting = true;
   Session::Abort();
+  m_abortevent.Signal();
 }
 
 bool Connection::Aborting()
@@ -155,42 +191,209 @@ MsgPacket* Connection::ReadResult(MsgPacket* vrp)
   if(m_connectionLost)
 	  return Session::ReadResult(vrp);
 
-  m_mutex.Lock();
+  uint32_t handle = SendRequest(vrp);
 
-  SMessage &message(m_queue[vrp->getUID()]);
-  message.event = new CondWait();
-  message.pkt   = NULL;
+  if(handle == 0)
+    return NULL;
 
-  m_mutex.Unlock();
+  return WaitResponse(handle);
+}
 
-  if(!Session::TransmitMessage(vrp))
+Connection::SMessage* Connection::FindRequest(uint32_t handle)
+{
+  for(uint32_t i = 0; i < MaxRequests; i++)
   {
-	MutexLock lock(&m_mutex);
-    m_queue.erase(vrp->getUID());
+    SMessage* slot = &m_slots[(handle + i) % MaxRequests];
+
+    if(slot->uid == handle && slot->state != SlotFree)
+      return slot;
+  }
+
+  return NULL;
+}
+
+Connection::SMessage* Connection::ClaimRequest(uint32_t uid)
+{
+  if(uid == SlotFree || uid >= SlotClaimed)
     return NULL;
+
+  // the slot is owned by whoever moves it out of the pending state
+  for(uint32_t i = 0; i < MaxRequests; i++)
+  {
+    SMessage* slot = &m_slots[(uid + i) % MaxRequests];
+
+    if(slot->state == uid && __sync_bool_compare_and_swap(&slot->state, uid, SlotClaimed))
+      return slot;
   }
 
-  message.event->Wait(m_timeout);
+  return NULL;
+}
+
+void Connection::ReleaseRequest(SMessage* slot)
+{
+  slot->pkt = NULL;
+
+  m_mutex.Lock();
+  slot->state = SlotFree;
+  m_pending--;
+  m_mutex.Unlock();
+
+  m_windowevent.Signal();
+}
+
+uint32_t Connection::SendRequest(MsgPacket* vrp)
+{
+  uint32_t uid = vrp->getUID();
+  TimeMs t;
+
+  if(uid == SlotFree || uid >= SlotClaimed)
+    return 0;
 
   m_mutex.Lock();
 
-  MsgPacket* vresp = message.pkt;
-  delete message.event;
+  // wait for a free slot in the request window
+  while(m_pending >= m_window)
+  {
+    m_mutex.Unlock();
+
+    int remaining = m_timeout - (int)t.Elapsed();
+
+    if(remaining <= 0 || !m_windowevent.Wait(remaining))
+    {
+      m_client->Log(FAILURE, "Request window full, dropping Message ID: %i", vrp->getMsgID());
+      return 0;
+    }
+
+    m_mutex.Lock();
+  }
+
+  // slots are indexed by uid, collisions move on to the next free slot
+  SMessage* slot = NULL;
+
+  for(int i = 0; slot == NULL; i++)
+  {
+    if(m_slots[(uid + i) % MaxRequests].state == SlotFree)
+      slot = &m_slots[(uid + i) % MaxRequests];
+  }
 
-  m_queue.erase(vrp->getUID());
+  slot->uid   = uid;
+  slot->msgid = vrp->getMsgID();
+  slot->pkt   = NULL;
+  slot->state = uid;
+
+  m_pending++;
+
+  // pass on the wakeup if there is still room in the window
+  if(m_pending < m_window)
+    m_windowevent.Signal();
 
   m_mutex.Unlock();
 
-  if(vresp == NULL)
-    m_client->Log(FAILURE, "Can't get response packet for Message ID: %i", vrp->getMsgID());
+  if(!Session::TransmitMessage(vrp))
+  {
+    CancelRequest(uid);
+    return 0;
+  }
+
+  return uid;
+}
+
+MsgPacket* Connection::WaitResponse(uint32_t handle)
+{
+  SMessage* slot = FindRequest(handle);
+
+  if(slot == NULL)
+    return NULL;
+
+  uint16_t msgid = slot->msgid;
+  TimeMs t;
+
+  for(;;)
+  {
+    uint32_t state = slot->state;
+
+    // response published
+    if(state == SlotDone)
+      break;
+
+    // still pending
+    if(state == handle)
+    {
+      int remaining = m_timeout - (int)t.Elapsed();
+
+      if(remaining > 0)
+      {
+        slot->event.Wait(remaining);
+        continue;
+      }
+
+      // timeout, make sure the response won't be published anymore
+      if(__sync_bool_compare_and_swap(&slot->state, handle, SlotClaimed))
+      {
+        ReleaseRequest(slot);
+        m_client->Log(FAILURE, "Can't get response packet for Message ID: %i", msgid);
+        return NULL;
+      }
+    }
+
+    // the receiving thread is just publishing the response
+  }
+
+  __sync_synchronize();
+  MsgPacket* vresp = slot->pkt;
+
+  ReleaseRequest(slot);
+
+  // compressed responses are inflated by the caller, not by the receiving thread
+  if(vresp->isCompressed() && !vresp->uncompress((MsgPacket::Codec)m_codec))
+  {
+    m_client->Log(FAILURE, "Can't uncompress response packet for Message ID: %i", msgid);
+    delete vresp;
+    return NULL;
+  }
 
   return vresp;
 }
 
-bool Connection::GetDriveSpace(long long *total, long long *used)
+bool Connection::ResponseReady(uint32_t handle)
 {
-  MutexLock lock(&m_cmdlock);
+  SMessage* slot = FindRequest(handle);
+  return (slot != NULL && slot->state == SlotDone);
+}
+
+void Connection::CancelRequest(uint32_t handle)
+{
+  SMessage* slot = FindRequest(handle);
+
+  if(slot == NULL)
+    return;
+
+  // discard a response which is already being published
+  if(!__sync_bool_compare_and_swap(&slot->state, handle, SlotClaimed))
+  {
+    while(slot->state != SlotDone)
+      __sync_synchronize();
+
+    delete slot->pkt;
+  }
 
+  ReleaseRequest(slot);
+}
+
+void Connection::SetRequestWindow(int size)
+{
+  if(size < 1)
+    size = 1;
+
+  if(size > (int)MaxRequests)
+    size = MaxRequests;
+
+  m_window = size;
+  m_windowevent.Signal();
+}
+
+bool Connection::GetDriveSpace(long long *total, long long *used)
+{
   MsgPacket vrp(XVDR_RECORDINGS_DISKSIZE);
 
   MsgPacket* vresp = ReadResult(&vrp);
@@ -233,8 +436,6 @@ bool Connection::SupportChannelScan()
 
 bool Connection::EnableStatusInterface(bool onOff)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_ENABLESTATUSINTERFACE);
   vrp.put_U8(onOff);
 
@@ -280,8 +481,6 @@ bool Connection::SetUpdateChannels(uint8_t method)
 
 bool Connection::ChannelFilter(bool fta, bool nativelangonly, std::vector<int>& caids)
 {
-  MutexLock lock(&m_cmdlock);
-
   std::size_t count = caids.size();
 
   MsgPacket vrp(XVDR_CHANNELFILTER);
@@ -317,8 +516,6 @@ bool Connection::ChannelFilter(bool fta, bool nativelangonly, std::vector<int>&
 
 int Connection::GetChannelsCount()
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_CHANNELS_GETCOUNT);
 
   MsgPacket* vresp = ReadResult(&vrp);
@@ -333,8 +530,6 @@ int Connection::GetChannelsCount()
 
 bool Connection::GetChannelsList(bool radio)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_CHANNELS_GETCHANNELS);
   vrp.put_U32(radio);
 
@@ -342,27 +537,104 @@ bool Connection::GetChannelsList(bool radio)
   if (!vresp)
     return false;
 
+  std::vector<uint32_t> channeluids;
+
   while (!vresp->eop())
   {
 	  Channel tag(vresp);
 	  tag.IsRadio = radio;
+    channeluids.push_back(tag.UID);
     m_client->TransferChannelEntry(tag);
   }
 
   delete vresp;
+
+  // EPG updates usually follow the channel list
+  MutexLock lock(&m_epglock);
+  m_channeluids[radio ? 1 : 0].swap(channeluids);
+
   return true;
 }
 
 bool Connection::GetEPGForChannel(uint32_t channeluid, time_t start, time_t end)
 {
-  MutexLock lock(&m_cmdlock);
+  uint32_t handle = 0;
+
+  {
+    MutexLock lock(&m_epglock);
+    bool prefetched = !m_epgrequests.empty();
+
+    // use a prefetched request, the ones in front of it won't be used anymore
+    while (!m_epgrequests.empty() && handle == 0)
+    {
+      SEpgRequest r = m_epgrequests.front();
+      m_epgrequests.pop_front();
+
+      if (r.channeluid == channeluid && r.start == start && r.end == end)
+        handle = r.handle;
+      else
+        CancelRequest(r.handle);
+    }
+
+    bool hit = (handle != 0);
+
+    if (handle == 0)
+      handle = SendEPGRequest(channeluid, start, end);
+
+    std::vector<uint32_t> channeluids(m_channeluids[0]);
+    channeluids.insert(channeluids.end(), m_channeluids[1].begin(), m_channeluids[1].end());
+
+    size_t index = std::find(channeluids.begin(), channeluids.end(), channeluid) - channeluids.begin();
+
+    // prefetch only while the calls follow the channel list with the same time range,
+    // after a miss it's restarted once they do again
+    bool follows = (index > 0 && index < channeluids.size() && channeluids[index - 1] == m_epglast.channeluid &&
+                    m_epglast.start == start && m_epglast.end == end);
+
+    if (hit || (!prefetched && follows))
+      PrefetchEPG(channeluids, index, start, end);
+
+    m_epglast.channeluid = channeluid;
+    m_epglast.start = start;
+    m_epglast.end = end;
+  }
+
+  // the response is transferred without the lock, channel lists may be fetched meanwhile
+  return TransferEPG(channeluid, handle);
+}
+
+bool Connection::GetEPGForChannels(const std::vector<uint32_t>& channeluids, time_t start, time_t end)
+{
+  std::vector<uint32_t> handles(channeluids.size(), 0);
+  size_t sent = 0;
+  bool rc = true;
+
+  // keep the request window filled while collecting the responses in order
+  for (size_t i = 0; i < channeluids.size(); i++)
+  {
+    for (; sent < channeluids.size() && (sent == i || (int)(sent - i) < m_window); sent++)
+      handles[sent] = SendEPGRequest(channeluids[sent], start, end);
+
+    if (!TransferEPG(channeluids[i], handles[i]))
+      rc = false;
+  }
+
+  return rc;
+}
 
+uint32_t Connection::SendEPGRequest(uint32_t channeluid, time_t start, time_t end)
+{
   MsgPacket vrp(XVDR_EPG_GETFORCHANNEL);
   vrp.put_U32(channeluid);
   vrp.put_U32(start);
   vrp.put_U32(end - start);
 
-  MsgPacket* vresp = ReadResult(&vrp);
+  return SendRequest(&vrp);
+}
+
+bool Connection::TransferEPG(uint32_t channeluid, uint32_t handle)
+{
+  MsgPacket* vresp = (handle != 0) ? WaitResponse(handle) : NULL;
   if (!vresp)
     return false;
 
@@ -377,13 +649,48 @@ bool Connection::GetEPGForChannel(uint32_t channeluid, time_t start, time_t end)
   return true;
 }
 
+void Connection::PrefetchEPG(const std::vector<uint32_t>& channeluids, size_t index, time_t start, time_t end)
+{
+  // the prefetched requests are the channels following the current one
+  for (size_t next = index + 1 + m_epgrequests.size(); next < channeluids.size() && m_epgrequests.size() < EpgPrefetch; next++)
+  {
+    // leave room in the request window for other requests
+    m_mutex.Lock();
+    bool full = (m_pending + (int)EpgPrefetch >= m_window);
+    m_mutex.Unlock();
+
+    if (full)
+      break;
+
+    SEpgRequest r;
+    r.channeluid = channeluids[next];
+    r.start = start;
+    r.end = end;
+    r.handle = SendEPGRequest(r.channeluid, start, end);
+
+    if (r.handle == 0)
+      break;
+
+    m_epgrequests.push_back(r);
+  }
+}
+
+void Connection::CancelEPGPrefetch()
+{
+  MutexLock lock(&m_epglock);
+
+  while (!m_epgrequests.empty())
+  {
+    CancelRequest(m_epgrequests.front().handle);
+    m_epgrequests.pop_front();
+  }
+}
+
 
 /** OPCODE's 60 - 69: XVDR network functions for timer access */
 
 int Connection::GetTimersCount()
 {
-  MutexLock lock(&m_cmdlock);
-
   // return caches values on connection loss
   if(ConnectionLost())
     return m_timercount;
@@ -402,8 +709,6 @@ int Connection::GetTimersCount()
 
 bool Connection::GetTimerInfo(unsigned int timernumber, Timer& tag)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_TIMER_GET);
   vrp.put_U32(timernumber);
 
@@ -432,8 +737,6 @@ bool Connection::GetTimerInfo(unsigned int timernumber, Timer& tag)
 
 bool Connection::GetTimersList()
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_TIMER_GETLIST);
 
   MsgPacket* vresp = ReadResult(&vrp);
@@ -458,8 +761,6 @@ bool Connection::GetTimersList()
 
 bool Connection::AddTimer(const Timer& timer)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_TIMER_ADD);
   vrp << timer;
 
@@ -477,8 +778,6 @@ bool Connection::AddTimer(const Timer& timer)
 
 int Connection::DeleteTimer(uint32_t timerindex, bool force)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_TIMER_DELETE);
   vrp.put_U32(timerindex);
   vrp.put_U32(force);
@@ -498,8 +797,6 @@ int Connection::DeleteTimer(uint32_t timerindex, bool force)
 
 bool Connection::UpdateTimer(const Timer& timer)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_TIMER_UPDATE);
   vrp << timer;
 
@@ -518,8 +815,6 @@ bool Connection::UpdateTimer(const Timer& timer)
 
 int Connection::GetRecordingsCount()
 {
-  MutexLock lock(&m_cmdlock);
-
   if(ConnectionLost())
     return 0;
 
@@ -537,8 +832,6 @@ int Connection::GetRecordingsCount()
 
 bool Connection::GetRecordingsList()
 {
-  MutexLock lock(&m_cmdlock);
-
   if(ConnectionLost())
     return true;
 
@@ -561,7 +854,6 @@ bool Connection::GetRecordingsList()
 
 bool Connection::RenameRecording(const std::string& recid, const std::string& newname)
 {
-  MutexLock lock(&m_cmdlock);
   m_client->Log(DEBUG, "%s - uid: %s", __FUNCTION__, recid.c_str());
 
   MsgPacket vrp(XVDR_RECORDINGS_RENAME);
@@ -583,8 +875,6 @@ bool Connection::RenameRecording(const std::string& recid, const std::string& ne
 
 int Connection::DeleteRecording(const std::string& recid)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_RECORDINGS_DELETE);
   vrp.put_String(recid.c_str());
 
@@ -612,12 +902,16 @@ void Connection::Action()
 
   while (Running())
   {
+    // connection has been aborted, stop receiving
+    if(Aborting())
+      break;
+
     // try to reconnect
     if(ConnectionLost() && !TryReconnect())
     {
-      CondWait::SleepMs(500);
+      m_abortevent.Wait(500);
       continue;
-   }
+    }
 
     // read message
     vresp = Session::ReadMessage();
@@ -626,18 +920,30 @@ void Connection::Action()
     if (vresp == NULL)
       continue;
 
+    // responses are uncompressed in ReadResult
+    if (vresp->getType() != XVDR_CHANNEL_REQUEST_RESPONSE && vresp->isCompressed() && !vresp->uncompress((MsgPacket::Codec)m_codec))
+    {
+      m_client->Log(FAILURE, "failed to uncompress packet (msgid: %i)", vresp->getMsgID());
+      delete vresp;
+      continue;
+    }
+
     // CHANNEL_REQUEST_RESPONSE
 
     if (vresp->getType() == XVDR_CHANNEL_REQUEST_RESPONSE)
     {
-      MutexLock lock(&m_mutex);
-      SMessages::iterator it = m_queue.find(vresp->getUID());
-      if (it != m_queue.end())
+      SMessage* slot = ClaimRequest(vresp->getUID());
+      if (slot != NULL)
       {
-        it->second.pkt = vresp;
-        it->second.event->Signal();
+        slot->pkt = vresp;
+        __sync_synchronize();
+        slot->state = SlotDone;
+        slot->event.Signal();
         vresp = NULL;
       }
+
+      // nobody waits for the response anymore (cancelled or timed out)
+      delete vresp;
     }
 
     // CHANNEL_STATUS
@@ -679,6 +985,8 @@ void Connection::Action()
       else if (vresp->getMsgID() == XVDR_STATUS_RECORDINGSCHANGE)
       {
         m_client->Log(DEBUG, "Server requested recordings update");
+        m_reader.RecordingsChanged();
+        m_index.Invalidate();
         m_client->TriggerRecordingUpdate();
       }
       else if (vresp->getMsgID() == XVDR_STATUS_CHANNELSCAN)
@@ -687,6 +995,8 @@ void Connection::Action()
         status << vresp;
         m_client->OnChannelScannerStatus(status);
       }
+
+      delete vresp;
     }
 
     // OTHER CHANNELID
@@ -700,8 +1010,6 @@ void Connection::Action()
 
 int Connection::GetChannelGroupCount(bool automatic)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_CHANNELGROUP_GETCOUNT);
   vrp.put_U32(automatic);
 
@@ -720,8 +1028,6 @@ int Connection::GetChannelGroupCount(bool automatic)
 
 bool Connection::GetChannelGroupList(bool bRadio)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_CHANNELGROUP_LIST);
   vrp.put_U8(bRadio);
 
@@ -744,8 +1050,6 @@ bool Connection::GetChannelGroupList(bool bRadio)
 
 bool Connection::GetChannelGroupMembers(const std::string& groupname, bool radio)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_CHANNELGROUP_MEMBERS);
   vrp.put_String(groupname.c_str());
   vrp.put_U8(radio);
@@ -782,9 +1086,10 @@ bool Connection::OpenRecording(const std::string& recid)
   uint32_t returnCode = vresp->get_U32();
   if (returnCode == XVDR_RET_OK)
   {
-    vresp->get_U32(); // number of frames is unused
-    m_currentPlayingRecordBytes     = vresp->get_U64();
-    m_currentPlayingRecordPosition  = 0;
+    uint32_t frames = vresp->get_U32();
+    uint64_t length = vresp->get_U64();
+
+    m_reader.Open(recid, frames, length);
     m_recid = recid;
   }
   else {
@@ -804,6 +1109,7 @@ bool Connection::CloseRecording()
     return false;
 
   m_recid.clear();
+  m_reader.Close();
 
   MsgPacket vrp(XVDR_RECSTREAM_CLOSE);
   MsgPacket* vresp = ReadResult(&vrp);
@@ -821,57 +1127,13 @@ int Connection::ReadRecording(unsigned char* buf, uint32_t buf_size)
   if (ConnectionLost())
     return 0;
 
-  if (m_currentPlayingRecordPosition >= m_currentPlayingRecordBytes)
-    return 0;
-
-  MsgPacket* vresp = NULL;
-
-  MsgPacket vrp1(XVDR_RECSTREAM_UPDATE);
-  if ((vresp = ReadResult(&vrp1)) != NULL)
-  {
-    vresp->get_U32(); // number of frames is unused
-    uint64_t bytes  = vresp->get_U64();
-
-    if(bytes != m_currentPlayingRecordBytes) {
-      m_currentPlayingRecordBytes  = bytes;
-      m_client->Log(DEBUG, "Size of recording changed: %lu bytes", bytes);
-    }
-    delete vresp;
-  }
-
-  MsgPacket vrp2(XVDR_RECSTREAM_GETBLOCK);
-  vrp2.put_U64(m_currentPlayingRecordPosition);
-  vrp2.put_U32(buf_size);
-
-  vresp = ReadResult(&vrp2);
-  if (!vresp)
-    return -1;
-
-  uint32_t length = vresp->getPayloadLength();
-
-  if(length == 0) {
-    return -1;
-  }
-
-  uint8_t *data = vresp->getPayload();
-  if (length > buf_size)
-  {
-    m_client->Log(FAILURE, "%s: PANIC - Received more bytes as requested", __FUNCTION__);
-    delete vresp;
-    return 0;
-  }
-
-  memcpy(buf, data, length);
-  m_currentPlayingRecordPosition += length;
-
-  delete vresp;
-  return length;
+  return m_reader.Read(buf, buf_size);
 }
 
 long long Connection::SeekRecording(long long pos, uint32_t whence)
 {
   MutexLock lock(&m_cmdlock);
-  uint64_t nextPos = m_currentPlayingRecordPosition;
+  uint64_t nextPos = m_reader.GetPosition();
 
   switch (whence)
   {
@@ -884,7 +1146,7 @@ long long Connection::SeekRecording(long long pos, uint32_t whence)
       break;
 
     case SEEK_END:
-      nextPos = m_currentPlayingRecordBytes + pos;
+      nextPos = m_reader.GetLength() + pos;
       break;
 
     case SEEK_POSSIBLE:
@@ -894,24 +1156,99 @@ long long Connection::SeekRecording(long long pos, uint32_t whence)
       return -1;
   }
 
-  if (nextPos > m_currentPlayingRecordBytes)
+  if (nextPos > m_reader.GetLength())
     return -1;
 
-  m_currentPlayingRecordPosition = nextPos;
+  m_reader.Seek(nextPos);
 
-  return m_currentPlayingRecordPosition;
+  return nextPos;
 }
 
 long long Connection::RecordingPosition(void)
 {
   MutexLock lock(&m_cmdlock);
-  return m_currentPlayingRecordPosition;
+  return m_reader.GetPosition();
 }
 
 long long Connection::RecordingLength(void)
 {
   MutexLock lock(&m_cmdlock);
-  return m_currentPlayingRecordBytes;
+  return m_reader.GetLength();
+}
+
+long long Connection::SeekRecordingFrame(uint32_t frame, bool backwards)
+{
+  MutexLock lock(&m_cmdlock);
+
+  if(m_recid.empty())
+    return -1;
+
+  uint32_t frames = m_reader.GetFrames();
+
+  if(frames > 0 && frame >= frames)
+    frame = frames - 1;
+
+  RecordingIndex::KeyFrame keyframe;
+  int64_t position;
+
+  if(m_index.GetKeyFrame(m_recid, frame, backwards, keyframe))
+    position = keyframe.position;
+
+  // no keyframe found, jump to the frame itself
+  else if((position = m_index.FrameToPosition(frame)) < 0)
+    return -1;
+
+  if((uint64_t)position > m_reader.GetLength())
+    return -1;
+
+  m_reader.Seek(position);
+
+  return position;
+}
+
+long long Connection::SeekRecordingTime(uint32_t ms, bool backwards, double fps)
+{
+  return SeekRecordingFrame((uint32_t)((double)ms * fps / 1000.0), backwards);
+}
+
+long long Connection::RecordingFrame(void)
+{
+  MutexLock lock(&m_cmdlock);
+
+  if(m_recid.empty())
+    return -1;
+
+  return m_index.PositionToFrame(m_reader.GetPosition());
+}
+
+uint32_t Connection::RecordingFrames(void)
+{
+  MutexLock lock(&m_cmdlock);
+  return m_reader.GetFrames();
+}
+
+void Connection::GetRecordingIndexStatistics(RecordingIndex::Statistics& s)
+{
+  MutexLock lock(&m_cmdlock);
+  m_index.GetStatistics(m_recid, s);
+}
+
+void Connection::GetRecordingStatistics(RecordingReader::Statistics& s)
+{
+  MutexLock lock(&m_cmdlock);
+  m_reader.GetStatistics(s);
+}
+
+bool Connection::SetRecordingCache(size_t memory, size_t disk, const std::string& file)
+{
+  MutexLock lock(&m_cmdlock);
+  return m_reader.SetCacheSize(memory, disk, file);
+}
+
+void Connection::GetRecordingCacheStatistics(BlockCache::Statistics& s)
+{
+  MutexLock lock(&m_cmdlock);
+  m_reader.GetCacheStatistics(s);
 }
 
 bool Connection::LoadRecordingEdl(const std::string& recid, RecordingEdl& edl)
@@ -977,6 +1314,14 @@ void Connection::SetCompressionLevel(int level)
   m_compressionlevel = level;
 }
 
+void Connection::SetCompressionCodec(int codec)
+{
+  if (codec < 0 || codec >= MsgPacket::CODEC_COUNT || !MsgPacket::isCodecSupported((MsgPacket::Codec)codec))
+    codec = MsgPacket::CODEC_ZLIB;
+
+  m_compressioncodec = codec;
+}
+
 void Connection::SetAudioType(int type)
 {
   m_audiotype = type;
@@ -984,8 +1329,6 @@ void Connection::SetAudioType(int type)
 
 bool Connection::SetRecordingPlayCount(const std::string& recid, int count)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_RECORDINGS_SETPLAYCOUNT);
   vrp.put_String(recid.c_str());
   vrp.put_U32(count);
@@ -1003,8 +1346,6 @@ bool Connection::SetRecordingPlayCount(const std::string& recid, int count)
 
 bool Connection::SetRecordingLastPosition(const std::string& recid, int64_t pos)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_RECORDINGS_SETPOSITION);
   vrp.put_String(recid.c_str());
   vrp.put_S64(pos);
@@ -1022,8 +1363,6 @@ bool Connection::SetRecordingLastPosition(const std::string& recid, int64_t pos)
 
 int64_t Connection::GetRecordingLastPosition(const std::string& recid)
 {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_RECORDINGS_GETPOSITION);
   vrp.put_String(recid.c_str());
 
@@ -1041,8 +1380,6 @@ int64_t Connection::GetRecordingLastPosition(const std::string& recid)
 }
 
 bool Connection::GetChannelScannerSetup(ChannelScannerSetup& setup, ChannelScannerList& satellites, ChannelScannerList& countries) {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_SCAN_GETSETUP);
   MsgPacket* vresp = ReadResult(&vrp);
 
@@ -1060,8 +1397,6 @@ bool Connection::GetChannelScannerSetup(ChannelScannerSetup& setup, ChannelScann
 }
 
 bool Connection::GetChannelScannerSetup(ChannelScannerSetup& setup) {
-  MutexLock lock(&m_cmdlock);
-
   ChannelScannerList satellites;
   ChannelScannerList countries;
 
@@ -1069,8 +1404,6 @@ bool Connection::GetChannelScannerSetup(ChannelScannerSetup& setup) {
 }
 
 bool Connection::SetChannelScannerSetup(const ChannelScannerSetup& setup) {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_SCAN_SETSETUP);
   vrp << setup;
 
@@ -1083,8 +1416,6 @@ bool Connection::SetChannelScannerSetup(const ChannelScannerSetup& setup) {
 }
 
 bool Connection::StartChannelScanner() {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_SCAN_START);
   MsgPacket* vresp = ReadResult(&vrp);
 
@@ -1095,8 +1426,6 @@ bool Connection::StartChannelScanner() {
 }
 
 bool Connection::StopChannelScanner() {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_SCAN_STOP);
   MsgPacket* vresp = ReadResult(&vrp);
 
@@ -1107,8 +1436,6 @@ bool Connection::StopChannelScanner() {
 }
 
 bool Connection::GetChannelScannerStatus(ChannelScannerStatus& status) {
-  MutexLock lock(&m_cmdlock);
-
   MsgPacket vrp(XVDR_SCAN_GETSTATUS);
   MsgPacket* vresp = ReadResult(&vrp);
 
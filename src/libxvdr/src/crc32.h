@@ -0,0 +1,127 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/** \file crc32.h
+	Header file for the CRC32 engine.
+	The engine used to compute the packet header and payload checksums.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace XVDR {
+
+/**
+	@short CRC32 engine
+
+	Computes the CRC32 (reflected polynomial 0xEDB88320) of a memory block.
+	The fastest implementation supported by the CPU is selected at runtime,
+	all implementations produce bit-identical results.
+*/
+
+class CRC32 {
+public:
+
+	typedef enum {
+		BYTEWISE = 0,		/*!< one table lookup per byte */
+		SLICING8 = 1,		/*!< slicing-by-8, eight bytes per iteration */
+		CLMUL = 2,			/*!< carry-less multiplication folding (x86 PCLMULQDQ) */
+		VARIANT_COUNT = 3
+	} Variant;
+
+	/**
+	Compute a CRC32 checksum.
+	Uses the fastest available implementation.
+
+	@param  buf		pointer to data array
+	@param  size	size of array in bytes
+	@return 32bit crc
+	*/
+	static uint32_t compute(const uint8_t* buf, size_t size);
+
+	/**
+	Update a running CRC32 checksum.
+	compute(a + b) equals update(compute(a), b). The initial value is 0.
+
+	@param  crc		crc of the preceding data
+	@param  buf		pointer to data array
+	@param  size	size of array in bytes
+	@return 32bit crc
+	*/
+	static uint32_t update(uint32_t crc, const uint8_t* buf, size_t size);
+
+	/**
+	Compute a CRC32 checksum with a specific implementation.
+
+	@param  variant	implementation to use (must be supported)
+	@param  buf		pointer to data array
+	@param  size	size of array in bytes
+	@return 32bit crc
+	*/
+	static uint32_t compute(Variant variant, const uint8_t* buf, size_t size);
+
+	/**
+	Check if an implementation is supported by the CPU.
+
+	@param  variant	implementation to check
+	@return true if supported
+	*/
+	static bool supported(Variant variant);
+
+	/**
+	Get the implementation selected at runtime.
+
+	@return selected implementation
+	*/
+	static Variant selected();
+
+	/**
+	Get the name of an implementation.
+
+	@param  variant	implementation
+	@return name of the implementation
+	*/
+	static const char* name(Variant variant);
+
+private:
+
+	typedef uint32_t (*Function)(uint32_t state, const uint8_t* buf, size_t size);
+
+	static uint32_t bytewise(uint32_t state, const uint8_t* buf, size_t size);
+
+	static uint32_t slicing8(uint32_t state, const uint8_t* buf, size_t size);
+
+	static uint32_t clmul(uint32_t state, const uint8_t* buf, size_t size);
+
+	static Function function(Variant variant);
+
+	static Variant select();
+
+	static Variant m_selected;
+
+	static Function m_function;
+};
+
+} // namespace XVDR
@@ -22,6 +22,8 @@
  *
  */
 
+#include <algorithm>
+
 #include "xvdr/dataset.h"
 #include "xvdr/msgpacket.h"
 
@@ -279,7 +281,54 @@ SignalStatus& XVDR::operator<< (SignalStatus& lhs, MsgPacket* rhs) {
   return lhs;
 }
 
+QueueStatus::QueueStatus() {
+  ServerQueued = 0;
+  ServerCapacity = 0;
+  ServerFill = 0;
+  Reports = 0;
+  LocalQueued = 0;
+  LocalCapacity = 0;
+  Dropped = 0;
+  Backlog = false;
+}
+
+QueueStatus::QueueStatus(MsgPacket* p) {
+  ServerQueued = 0;
+  ServerCapacity = 0;
+  ServerFill = 0;
+  Reports = 0;
+  LocalQueued = 0;
+  LocalCapacity = 0;
+  Dropped = 0;
+  Backlog = false;
+
+  (*this) << p;
+}
+
+QueueStatus& XVDR::operator<< (QueueStatus& lhs, MsgPacket* rhs) {
+  lhs.ServerQueued = rhs->get_U32();
+  lhs.ServerCapacity = 0;
+
+  if(!rhs->eop()) {
+    lhs.ServerCapacity = rhs->get_U32();
+  }
+
+  // without the queue size the first value is the fill level in percent
+  if(lhs.ServerCapacity == 0) {
+    lhs.ServerFill = std::min(lhs.ServerQueued, (uint32_t)100);
+  }
+  else {
+    lhs.ServerFill = (uint32_t)(((uint64_t)lhs.ServerQueued * 100) / lhs.ServerCapacity);
+  }
+
+  lhs.Reports++;
+
+  return lhs;
+}
+
 Stream::Stream() {
+  ContentId = CONTENT_UNKNOWN;
+  Codec = CODEC_UNKNOWN;
   Index = 0;
   Identifier = 0;
   PhysicalId = 0;
@@ -296,12 +345,124 @@ Stream::Stream() {
 }
 
 
+void Stream::SetType(const std::string& type) {
+  Type = type;
+  Codec = GetCodecId(type);
+  ContentId = GetContentType(Codec);
+  Content = GetContentName(ContentId);
+}
+
+Stream::CodecId Stream::GetCodecId(const std::string& type) {
+  static const struct {
+    const char* name;
+    CodecId codec;
+  } codecs[] = {
+    { "MPEG2VIDEO", CODEC_MPEG2VIDEO },
+    { "H264", CODEC_H264 },
+    { "MPEG2AUDIO", CODEC_MPEG2AUDIO },
+    { "AC3", CODEC_AC3 },
+    { "EAC3", CODEC_EAC3 },
+    { "AAC", CODEC_AAC },
+    { "DVBSUB", CODEC_DVBSUB },
+    { "TELETEXT", CODEC_TELETEXT }
+  };
+
+  for(size_t i = 0; i < sizeof(codecs) / sizeof(codecs[0]); i++) {
+    if(type == codecs[i].name)
+      return codecs[i].codec;
+  }
+
+  return CODEC_UNKNOWN;
+}
+
+Stream::ContentType Stream::GetContentType(CodecId codec) {
+  switch(codec) {
+    case CODEC_MPEG2VIDEO:
+    case CODEC_H264:
+      return CONTENT_VIDEO;
+    case CODEC_MPEG2AUDIO:
+    case CODEC_AC3:
+    case CODEC_EAC3:
+    case CODEC_AAC:
+      return CONTENT_AUDIO;
+    case CODEC_DVBSUB:
+      return CONTENT_SUBTITLE;
+    case CODEC_TELETEXT:
+      return CONTENT_TELETEXT;
+    default:
+      return CONTENT_UNKNOWN;
+  }
+}
+
+const char* Stream::GetContentName(ContentType content) {
+  switch(content) {
+    case CONTENT_VIDEO:
+      return "VIDEO";
+    case CONTENT_AUDIO:
+      return "AUDIO";
+    case CONTENT_SUBTITLE:
+      return "SUBTITLE";
+    case CONTENT_TELETEXT:
+      return "TELETEXT";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+StreamTable::StreamTable() {
+  clear();
+}
+
+void StreamTable::clear() {
+  for(int i = 0; i < TableSize; i++) {
+    m_entries[i].PhysicalId = 0;
+    m_entries[i].Index = -1;
+    m_entries[i].Content = Stream::CONTENT_UNKNOWN;
+    m_entries[i].Codec = Stream::CODEC_UNKNOWN;
+  }
+
+  m_count = 0;
+}
+
+bool StreamTable::insert(const Stream& stream) {
+  if(m_count >= TableSize / 2)
+    return false;
+
+  uint32_t slot = Hash(stream.PhysicalId);
+
+  while(m_entries[slot].Index != -1 && m_entries[slot].PhysicalId != stream.PhysicalId)
+    slot = (slot + 1) & (TableSize - 1);
+
+  if(m_entries[slot].Index == -1)
+    m_count++;
+
+  m_entries[slot].PhysicalId = stream.PhysicalId;
+  m_entries[slot].Index = stream.Index;
+  m_entries[slot].Content = stream.ContentId;
+  m_entries[slot].Codec = stream.Codec;
+
+  return true;
+}
+
+void StreamProperties::clear() {
+  std::map<uint32_t, Stream>::clear();
+  m_table.clear();
+}
+
+void StreamProperties::UpdateTable() {
+  m_table.clear();
+
+  for(const_iterator i = begin(); i != end(); i++)
+    m_table.insert(i->second);
+}
+
 bool XVDR::operator==(Stream const& lhs, Stream const& rhs) {
   return
     lhs.Index == rhs.Index &&
     lhs.Identifier == rhs.Identifier &&
     lhs.PhysicalId == rhs.PhysicalId &&
     lhs.Type == rhs.Type &&
+    lhs.Codec == rhs.Codec &&
     lhs.Language == rhs.Language &&
     lhs.FpsScale == rhs.FpsScale &&
     lhs.FpsRate == rhs.FpsRate &&
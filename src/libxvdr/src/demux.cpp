@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <string.h>
+#include <algorithm>
 
 #include "xvdr/demux.h"
 #include "xvdr/msgpacket.h"
@@ -36,19 +37,32 @@ using namespace XVDR;
 
 Demux::Demux(ClientInterface* client, PacketBuffer* buffer) : Connection(client), mPriority(50),
 	mPaused(false), mTimeShiftMode(false), mChannelUID(0), mBuffer(buffer),
-	mIFrameStart(false) {
+	mLiveFlush(0), mLiveQueueSize(0), mCredits(0), mCreditTime(0),
+	mBacklog(0), mLiveDropped(0), mBufferSize(0), mIFrameStart(false) {
 	mCanSeekStream = (mBuffer != NULL);
+	ReserveBacklog();
 
-	// create a small memory buffer as queue
-	if(mBuffer == NULL) {
-		mBuffer = PacketBuffer::create(10 * 1024 * 1024);
-	}
+	// without a packetbuffer packets are passed through the live queue
+	mPending.msg = NULL;
+	mPending.packet = NULL;
+	mPending.size = 0;
 }
 
 Demux::~Demux() {
+	// stop the receive thread first, it writes into the pending packet
+	// and the live ring until it has ended
+	Connection::Abort();
+	Cancel(1);
+
 	// wait for pending requests
 	MutexLock lock(&mLock);
 	delete mBuffer;
+
+	DrainLiveRing();
+
+	if(mPending.packet != NULL) {
+		m_client->FreePacket(mPending.packet);
+	}
 }
 
 Demux::SwitchStatus Demux::OpenChannel(const std::string& hostname, uint32_t channeluid, const std::string& clientname) {
@@ -67,6 +81,22 @@ void Demux::CloseChannel() {
     CleanupPacketQueue();
 }
 
+void Demux::SetPacketBuffer(PacketBuffer* buffer) {
+	MutexLock lock(&mLock);
+
+	if(buffer == mBuffer) {
+		return;
+	}
+
+	delete mBuffer;
+	mBuffer = buffer;
+	mCanSeekStream = (mBuffer != NULL);
+	ReserveBacklog();
+
+	mQueueStatus.Backlog = false;
+	__atomic_store_n(&mBacklog, 0, __ATOMIC_RELEASE);
+}
+
 StreamProperties Demux::GetStreamProperties() {
 	MutexLock lock(&mLock);
 	return mStreams;
@@ -74,7 +104,113 @@ StreamProperties Demux::GetStreamProperties() {
 
 void Demux::CleanupPacketQueue() {
 	MutexLock lock(&mLock);
-	mBuffer->clear();
+
+	if(mBuffer != NULL) {
+		mBuffer->clear();
+	}
+
+	// queued live packets are discarded by the reader
+	__atomic_store_n(&mLiveFlush, mLiveRing.tail(), __ATOMIC_RELEASE);
+}
+
+void Demux::DrainLiveRing() {
+	LivePacket item;
+
+	while(mLiveRing.pop(item)) {
+		__atomic_sub_fetch(&mLiveQueueSize, item.size, __ATOMIC_RELAXED);
+		FreeLivePacket(item);
+	}
+}
+
+void Demux::FreeLivePacket(LivePacket& p) {
+	delete p.msg;
+
+	if(p.packet != NULL) {
+		m_client->FreePacket(p.packet);
+	}
+}
+
+void Demux::PutLivePacket(MsgPacket* p) {
+	LivePacket item;
+	item.msg = p;
+	item.packet = NULL;
+	item.size = p->getPacketLength();
+
+	// payload received into the client packet ?
+	if(mPending.packet != NULL && mPending.msg == p) {
+		item.packet = mPending.packet;
+		item.size += mPending.size;
+		mPending.packet = NULL;
+	}
+
+	mPending.msg = NULL;
+
+	// requested packet (timeshift mode) consumes a credit
+	if(mTimeShiftMode && p->getMsgID() == XVDR_STREAM_MUXPKT) {
+		__atomic_sub_fetch(&mCredits, 1, __ATOMIC_ACQ_REL);
+		__atomic_store_n(&mCreditTime, TimeMs::Now(), __ATOMIC_RELEASE);
+	}
+
+	// the queue may grow while the server reports a backlog
+	size_t limit = __atomic_load_n(&mBacklog, __ATOMIC_ACQUIRE) ? BacklogQueueSize : LiveQueueSize;
+
+	// drop the packet if the reader doesn't keep up
+	if(__atomic_load_n(&mLiveQueueSize, __ATOMIC_RELAXED) + item.size > limit || !mLiveRing.push(item)) {
+		__atomic_add_fetch(&mLiveDropped, 1, __ATOMIC_RELAXED);
+		FreeLivePacket(item);
+		return;
+	}
+
+	__atomic_add_fetch(&mLiveQueueSize, item.size, __ATOMIC_RELAXED);
+	mLiveRing.wakeup(mCondition);
+}
+
+uint32_t Demux::GetPayloadPrefix(MsgPacket* p) {
+	// client packet of a failed reception
+	if(mPending.packet != NULL) {
+		m_client->FreePacket(mPending.packet);
+		mPending.packet = NULL;
+	}
+
+	mPending.msg = NULL;
+
+	if(mCanSeekStream || p->getType() != XVDR_CHANNEL_STREAM || p->getMsgID() != XVDR_STREAM_MUXPKT) {
+		return 0;
+	}
+
+	return MuxHeaderLength;
+}
+
+uint8_t* Demux::GetPayloadBuffer(MsgPacket* p, uint32_t length) {
+	p->get_U16();	// id
+	p->get_S64();	// pts
+	p->get_S64();	// dts
+	p->get_U32();	// duration
+	uint32_t size = p->get_U32();
+	p->rewind();
+
+	if(size != length) {
+		return NULL;
+	}
+
+	Packet* packet = m_client->AllocatePacket(length);
+
+	if(packet == NULL) {
+		return NULL;
+	}
+
+	uint8_t* data = m_client->GetPacketBuffer(packet);
+
+	if(data == NULL) {
+		m_client->FreePacket(packet);
+		return NULL;
+	}
+
+	mPending.msg = p;
+	mPending.packet = packet;
+	mPending.size = length;
+
+	return data;
 }
 
 void Demux::Abort() {
@@ -84,36 +220,91 @@ void Demux::Abort() {
 	mCondition.Signal();
 }
 
-Packet* Demux::Read() {
-	if(ConnectionLost() || Aborting()) {
-		return NULL;
+bool Demux::RequestPacket() {
+	// packets are only requested in timeshift mode
+	if(!mTimeShiftMode) {
+		return true;
 	}
 
-	Packet* p = NULL;
-	MsgPacket* pkt = NULL;
+	int credits = __atomic_load_n(&mCredits, __ATOMIC_ACQUIRE);
 
-	// request packets in timeshift mode
-	if(mTimeShiftMode) {
-		MsgPacket req(XVDR_CHANNELSTREAM_REQUEST, XVDR_CHANNEL_STREAM);
+	// the server doesn't answer requests once it caught up with the live stream
+	if(credits > 0 && TimeMs::Now() - __atomic_load_n(&mCreditTime, __ATOMIC_ACQUIRE) > CreditTimeout) {
+		__atomic_store_n(&mCredits, 0, __ATOMIC_RELEASE);
+		credits = 0;
+	}
 
-		if(!Session::TransmitMessage(&req)) {
-			return NULL;
-		}
+	if(credits < 0) {
+		credits = 0;
 	}
 
-	// fetch packet from packetbuffer (queue))
-	{
+	// top up the window when the local queue drains below the low-water mark
+	int queued = (int)mLiveRing.size();
+
+	if(credits + queued >= RequestLowWater || __atomic_load_n(&mLiveQueueSize, __ATOMIC_RELAXED) >= LiveQueueSize / 2) {
+		return true;
+	}
+
+	// catch up faster if the server queue fills
+	int window = __atomic_load_n(&mBacklog, __ATOMIC_ACQUIRE) ? BacklogRequestWindow : RequestWindow;
+	int grant = window - credits - queued;
+	MsgPacket req(XVDR_CHANNELSTREAM_REQUEST, XVDR_CHANNEL_STREAM);
+
+	if(!Session::TransmitMessage(&req, grant)) {
+		return false;
+	}
+
+	__atomic_store_n(&mCreditTime, TimeMs::Now(), __ATOMIC_RELEASE);
+	__atomic_add_fetch(&mCredits, grant, __ATOMIC_ACQ_REL);
+
+	return true;
+}
+
+int Demux::FetchPackets(LivePacket* items, int count) {
+	int n = 0;
+
+	// fetch packets from packetbuffer (timeshift)
+	if(mBuffer != NULL) {
 		MutexLock lock(&mLock);
-		pkt = mBuffer->get();
+
+		while(n < count && (items[n].msg = mBuffer->get()) != NULL) {
+			items[n].packet = NULL;
+			n++;
+		}
+
+		return n;
 	}
 
-	// empty queue -> return empty packet
-	if(pkt == NULL) {
-		mCondition.Wait(100);
-		p = m_client->AllocatePacket(0);
-		return p;
+	// fetch packets from the live ring
+	uint32_t position = 0;
+
+	while(n < count && mLiveRing.pop(items[n], &position)) {
+		__atomic_sub_fetch(&mLiveQueueSize, items[n].size, __ATOMIC_RELAXED);
+
+		// packet has been queued before the last cleanup
+		if((int32_t)(__atomic_load_n(&mLiveFlush, __ATOMIC_ACQUIRE) - position) > 0) {
+			FreeLivePacket(items[n]);
+			continue;
+		}
+
+		n++;
+	}
+
+	return n;
+}
+
+bool Demux::WaitPackets(int timeout) {
+	if(mBuffer != NULL) {
+		mCondition.Wait(timeout);
+		return true;
 	}
 
+	return mLiveRing.wait(mCondition, timeout);
+}
+
+Packet* Demux::CreatePacket(MsgPacket* pkt, Packet* payload) {
+	Packet* p = NULL;
+
 	if(pkt->getMsgID() == XVDR_STREAM_CHANGE) {
 		StreamChange(pkt);
 		p = m_client->StreamChange(mStreams);
@@ -124,26 +315,114 @@ Packet* Demux::Read() {
 		int64_t dts = pkt->get_S64();
 		uint32_t duration = pkt->get_U32();
 		uint32_t length = pkt->get_U32();
-		uint8_t* payload = pkt->consume(length);
 
-		if(mStreams.find(id) == mStreams.end()) {
-			p = m_client->AllocatePacket(0);
+		// packet of an unknown stream
+		const StreamTable::Entry* stream = mStreams.GetTable().find(id);
+
+		if(stream == NULL) {
+			if(payload != NULL) {
+				m_client->FreePacket(payload);
+			}
+		}
+		// payload has already been received into the client packet
+		else if(payload != NULL) {
+			p = payload;
+			m_client->SetPacketData(p, NULL, stream->Index, dts, pts, duration);
 		}
 		else {
-			Stream& stream = mStreams[id];
 			p = m_client->AllocatePacket(length);
-			m_client->SetPacketData(p, payload, stream.Index, dts, pts, duration);
+			m_client->SetPacketData(p, pkt->consume(length), stream->Index, dts, pts, duration);
 		}
 	}
 
-	{
-		MutexLock lock(&mLock);
-		mBuffer->release(pkt);
+	if(mBuffer == NULL) {
+		delete pkt;
 	}
 
 	return p;
 }
 
+void Demux::ReleasePackets(LivePacket* items, int count) {
+	if(mBuffer == NULL || count == 0) {
+		return;
+	}
+
+	MutexLock lock(&mLock);
+
+	for(int i = 0; i < count; i++) {
+		mBuffer->release(items[i].msg);
+	}
+}
+
+Packet* Demux::Read() {
+	if(ConnectionLost() || Aborting()) {
+		return NULL;
+	}
+
+	Packet* p = Read(100);
+
+	// empty queue -> return empty packet
+	if(p == NULL && !ConnectionLost() && !Aborting()) {
+		p = m_client->AllocatePacket(0);
+	}
+
+	return p;
+}
+
+Packet* Demux::Read(int timeout) {
+	Packet* p = NULL;
+	return (ReadMany(&p, 1, timeout) == 1) ? p : NULL;
+}
+
+int Demux::ReadMany(Packet** packets, int count, int timeout) {
+	LivePacket items[ReadBatchSize];
+	TimeMs t;
+	int n = 0;
+
+	if(count > ReadBatchSize) {
+		count = ReadBatchSize;
+	}
+
+	if(ConnectionLost() || Aborting()) {
+		return 0;
+	}
+
+	while(n == 0) {
+		if(!RequestPacket()) {
+			break;
+		}
+
+		int fetched = FetchPackets(items, count);
+
+		for(int i = 0; i < fetched; i++) {
+			Packet* p = CreatePacket(items[i].msg, items[i].packet);
+
+			if(p != NULL) {
+				packets[n++] = p;
+			}
+		}
+
+		ReleasePackets(items, fetched);
+
+		if(n > 0) {
+			break;
+		}
+
+		// wait until data arrives or the deadline expires
+		int remaining = timeout - (int)t.Elapsed();
+
+		if(remaining <= 0 || ConnectionLost() || Aborting()) {
+			break;
+		}
+
+		if(fetched == 0) {
+			WaitPackets(mTimeShiftMode ? std::min(remaining, (int)CreditTimeout) : remaining);
+		}
+	}
+
+	return n;
+}
+
 bool Demux::OnResponsePacket(MsgPacket* resp) {
 	if(resp->getType() != XVDR_CHANNEL_STREAM) {
 		return false;
@@ -163,8 +442,19 @@ bool Demux::OnResponsePacket(MsgPacket* resp) {
 			StreamSignalInfo(resp);
 			break;
 
+		case XVDR_STREAM_QUEUESTATUS:
+			StreamQueueStatus(resp);
+			break;
+
 		case XVDR_STREAM_CHANGE:
-		case XVDR_STREAM_MUXPKT: {
+		case XVDR_STREAM_MUXPKT:
+			// live packets are passed to the reader without locking
+			if(mBuffer == NULL) {
+				PutLivePacket(resp);
+				return true;
+			}
+
+			{
 				MutexLock lock(&mLock);
 				mBuffer->put(resp);
 				mCondition.Signal();
@@ -188,6 +478,9 @@ Demux::SwitchStatus Demux::SwitchChannel(uint32_t channeluid) {
 	{
 		MutexLock lock(&mLock);
 		mStreams.clear();
+		SetBacklog(false);
+		mQueueStatus.ServerQueued = 0;
+		mQueueStatus.ServerFill = 0;
 	}
 
 	mCondition.Signal();
@@ -228,34 +521,22 @@ SignalStatus Demux::GetSignalStatus() {
 	return mSignalStatus;
 }
 
-void Demux::GetContentFromType(const std::string& type, std::string& content) {
-	if(type == "AC3") {
-		content = "AUDIO";
-	}
-	else if(type == "MPEG2AUDIO") {
-		content = "AUDIO";
-	}
-	else if(type == "AAC") {
-		content = "AUDIO";
-	}
-	else if(type == "EAC3") {
-		content = "AUDIO";
-	}
-	else if(type == "MPEG2VIDEO") {
-		content = "VIDEO";
-	}
-	else if(type == "H264") {
-		content = "VIDEO";
-	}
-	else if(type == "DVBSUB") {
-		content = "SUBTITLE";
-	}
-	else if(type == "TELETEXT") {
-		content = "TELETEXT";
+QueueStatus Demux::GetQueueStatus() {
+	MutexLock lock(&mLock);
+	QueueStatus status = mQueueStatus;
+
+	if(mBuffer != NULL) {
+		status.LocalQueued = mBuffer->size();
+		status.LocalCapacity = mBuffer->get_max_size();
 	}
 	else {
-		content = "UNKNOWN";
+		status.LocalQueued = __atomic_load_n(&mLiveQueueSize, __ATOMIC_RELAXED);
+		status.LocalCapacity = __atomic_load_n(&mBacklog, __ATOMIC_ACQUIRE) ? BacklogQueueSize : LiveQueueSize;
 	}
+
+	status.Dropped = __atomic_load_n(&mLiveDropped, __ATOMIC_RELAXED);
+
+	return status;
 }
 
 void Demux::StreamChange(MsgPacket* resp) {
@@ -271,13 +552,11 @@ void Demux::StreamChange(MsgPacket* resp) {
 
 		stream.Index = index++;
 		stream.PhysicalId = resp->get_U32();
-		stream.Type = resp->get_String();
-
-		GetContentFromType(stream.Type, stream.Content);
+		stream.SetType(resp->get_String());
 
 		stream.Identifier = -1;
 
-		if(stream.Content == "AUDIO") {
+		if(stream.ContentId == Stream::CONTENT_AUDIO) {
 			stream.Language = resp->get_String();
 			stream.Channels = resp->get_U32();
 			stream.SampleRate = resp->get_U32();
@@ -285,14 +564,14 @@ void Demux::StreamChange(MsgPacket* resp) {
 			stream.BitRate = resp->get_U32();
 			stream.BitsPerSample = resp->get_U32();
 		}
-		else if(stream.Content == "VIDEO") {
+		else if(stream.ContentId == Stream::CONTENT_VIDEO) {
 			stream.FpsScale = resp->get_U32();
 			stream.FpsRate = resp->get_U32();
 			stream.Height = resp->get_U32();
 			stream.Width = resp->get_U32();
 			stream.Aspect = (double)resp->get_S64() / 10000.0;
 		}
-		else if(stream.Content == "SUBTITLE") {
+		else if(stream.ContentId == Stream::CONTENT_SUBTITLE) {
 			stream.Language = resp->get_String();
 			composition_id = resp->get_U32();
 			ancillary_id   = resp->get_U32();
@@ -306,6 +585,9 @@ void Demux::StreamChange(MsgPacket* resp) {
 
 		mStreams[stream.PhysicalId] = stream;
 	}
+
+	// resolve the per packet lookup table once
+	mStreams.UpdateTable();
 }
 
 void Demux::StreamStatus(MsgPacket* resp) {
@@ -330,6 +612,58 @@ void Demux::StreamSignalInfo(MsgPacket* resp) {
 	mSignalStatus << resp;
 }
 
+void Demux::StreamQueueStatus(MsgPacket* resp) {
+	MutexLock lock(&mLock);
+	mQueueStatus << resp;
+
+	// hysteresis between entering and leaving backlog mode
+	if(mQueueStatus.ServerFill >= BacklogHighWater) {
+		SetBacklog(true);
+	}
+	else if(mQueueStatus.ServerFill <= BacklogLowWater) {
+		SetBacklog(false);
+	}
+
+	if(!mQueueStatus.Backlog) {
+		return;
+	}
+
+	// the server holds packets back, don't let the reader sleep on a timeout
+	if(mBuffer != NULL) {
+		mCondition.Signal();
+	}
+	else {
+		mLiveRing.wakeup(mCondition);
+	}
+}
+
+void Demux::SetBacklog(bool on) {
+	if(on == mQueueStatus.Backlog) {
+		return;
+	}
+
+	mQueueStatus.Backlog = on;
+	__atomic_store_n(&mBacklog, on ? 1 : 0, __ATOMIC_RELEASE);
+
+	// use the reserved part of the packetbuffer, so the oldest unread packets aren't dropped
+	if(mBuffer != NULL) {
+		mBuffer->set_max_size(on ? mBufferSize : mBufferSize - (mBufferSize * BacklogReserve) / 100);
+	}
+
+	m_client->Log(on ? INFO : DEBUG, "%s - server queue %u%% full, backlog mode %s", __FUNCTION__, mQueueStatus.ServerFill, on ? "on" : "off");
+}
+
+void Demux::ReserveBacklog() {
+	if(mBuffer == NULL) {
+		mBufferSize = 0;
+		return;
+	}
+
+	// the buffers can't grow beyond their initial size, keep a part free for the backlog mode
+	mBufferSize = mBuffer->get_max_size();
+	mBuffer->set_max_size(mBufferSize - (mBufferSize * BacklogReserve) / 100);
+}
+
 void Demux::OnDisconnect() {
 }
 
@@ -360,6 +694,7 @@ void Demux::Pause(bool on) {
 
 		if(!on && mPaused) {
 			mTimeShiftMode = true;
+			__atomic_store_n(&mCredits, 0, __ATOMIC_RELEASE);
 		}
 
 		mPaused = on;
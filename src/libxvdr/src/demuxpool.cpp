@@ -0,0 +1,220 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "xvdr/demuxpool.h"
+#include "xvdr/clientinterface.h"
+
+using namespace XVDR;
+
+DemuxPool::DemuxPool(ClientInterface* client, int size) : mClient(client), mSize(size),
+	mTimeout(3000), mAudioType(0), mGeneration(0) {
+	if(mSize < 1) {
+		mSize = 1;
+	}
+
+	Start();
+}
+
+DemuxPool::~DemuxPool() {
+	Close();
+
+	Cancel(-1);
+	mEvent.Signal();
+	Cancel(5);
+
+	while(!mRetired.empty()) {
+		mRetired.front()->Close();
+		delete mRetired.front();
+		mRetired.pop_front();
+	}
+}
+
+void DemuxPool::Open(const std::string& hostname, const std::string& clientname) {
+	MutexLock lock(&mLock);
+
+	if(hostname != mHostname || clientname != mClientName) {
+		RetireStandby();
+	}
+
+	mHostname = hostname;
+	mClientName = clientname;
+	mRetry.Set(0);
+
+	mEvent.Signal();
+}
+
+void DemuxPool::Close() {
+	MutexLock lock(&mLock);
+
+	mHostname.clear();
+	RetireStandby();
+
+	mEvent.Signal();
+}
+
+Demux* DemuxPool::Claim(PacketBuffer* buffer) {
+	Demux* demux = NULL;
+
+	{
+		MutexLock lock(&mLock);
+
+		while(demux == NULL && !mStandby.empty()) {
+			demux = mStandby.front();
+			mStandby.pop_front();
+
+			// the server may have dropped the idle connection
+			if(demux->ConnectionLost()) {
+				mRetired.push_back(demux);
+				demux = NULL;
+			}
+		}
+	}
+
+	// refill the pool
+	mEvent.Signal();
+
+	if(demux == NULL) {
+		return NULL;
+	}
+
+	demux->SetPacketBuffer(buffer);
+	return demux;
+}
+
+void DemuxPool::Release(Demux* demux) {
+	if(demux == NULL) {
+		return;
+	}
+
+	// stop the stream immediately, the server frees the device on disconnect
+	demux->Abort();
+
+	MutexLock lock(&mLock);
+	mRetired.push_back(demux);
+	mEvent.Signal();
+}
+
+void DemuxPool::SetTimeout(int ms) {
+	MutexLock lock(&mLock);
+	mTimeout = ms;
+
+	for(std::deque<Demux*>::iterator i = mStandby.begin(); i != mStandby.end(); i++) {
+		(*i)->SetTimeout(ms);
+	}
+}
+
+void DemuxPool::SetAudioType(int type) {
+	MutexLock lock(&mLock);
+
+	// the audio type is negotiated at login
+	if(type != mAudioType) {
+		RetireStandby();
+	}
+
+	mAudioType = type;
+	mEvent.Signal();
+}
+
+int DemuxPool::GetStandbyCount() {
+	MutexLock lock(&mLock);
+	return (int)mStandby.size();
+}
+
+void DemuxPool::RetireStandby() {
+	while(!mStandby.empty()) {
+		mRetired.push_back(mStandby.front());
+		mStandby.pop_front();
+	}
+
+	// connections in progress are outdated
+	mGeneration++;
+}
+
+Demux* DemuxPool::CreateDemux() {
+	return new Demux(mClient);
+}
+
+void DemuxPool::Action() {
+	while(Running()) {
+		Demux* demux = NULL;
+		bool connect = false;
+		std::string hostname;
+		std::string clientname;
+		uint32_t generation = 0;
+		int timeout = 0;
+		int audiotype = 0;
+
+		{
+			MutexLock lock(&mLock);
+
+			if(!mRetired.empty()) {
+				demux = mRetired.front();
+				mRetired.pop_front();
+			}
+			else if(!mHostname.empty() && (int)mStandby.size() < mSize && mRetry.TimedOut()) {
+				connect = true;
+				hostname = mHostname;
+				clientname = mClientName;
+				generation = mGeneration;
+				timeout = mTimeout;
+				audiotype = mAudioType;
+			}
+		}
+
+		// teardown of released demuxers (may block in Cancel)
+		if(demux != NULL) {
+			demux->Close();
+			delete demux;
+			continue;
+		}
+
+		if(!connect) {
+			mEvent.Wait(1000);
+			continue;
+		}
+
+		// establish a new standby connection
+		demux = CreateDemux();
+		demux->SetTimeout(timeout);
+		demux->SetAudioType(audiotype);
+
+		if(!demux->Open(hostname, clientname)) {
+			mClient->Log(FAILURE, "%s - unable to connect standby demuxer", __FUNCTION__);
+			delete demux;
+
+			MutexLock lock(&mLock);
+			mRetry.Set(RetryInterval);
+			continue;
+		}
+
+		MutexLock lock(&mLock);
+
+		if(generation != mGeneration || mHostname.empty()) {
+			mRetired.push_back(demux);
+		}
+		else {
+			mStandby.push_back(demux);
+		}
+	}
+}
@@ -0,0 +1,163 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "os-config.h"
+#include "xvdr/msgpacketpool.h"
+
+#define CLASS_COUNT (MsgPacketPool::MaxClassShift - MsgPacketPool::MinClassShift + 1)
+
+// free blocks are linked through their first bytes
+struct FreeBlock {
+	FreeBlock* next;
+};
+
+static pthread_mutex_t poolmutex = PTHREAD_MUTEX_INITIALIZER;
+
+static FreeBlock* pool[CLASS_COUNT];
+
+static size_t poollimit = MsgPacketPool::DefaultLimit;
+
+static MsgPacketPool::Statistics poolstats;
+
+static inline int sizeclass(uint32_t size) {
+	int c = 0;
+
+	while(c < CLASS_COUNT - 1 && size > (1U << (c + MsgPacketPool::MinClassShift))) {
+		c++;
+	}
+
+	return c;
+}
+
+uint32_t MsgPacketPool::capacity(uint32_t size) {
+	if(size > (1U << MaxClassShift)) {
+		return size;
+	}
+
+	return 1U << (sizeclass(size) + MinClassShift);
+}
+
+void* MsgPacketPool::acquire(uint32_t size, uint32_t* cap) {
+	uint32_t blocksize = capacity(size);
+
+	if(cap != NULL) {
+		*cap = blocksize;
+	}
+
+	// oversized blocks aren't pooled
+	if(blocksize > (1U << MaxClassShift)) {
+		pthread_mutex_lock(&poolmutex);
+		poolstats.misses++;
+		pthread_mutex_unlock(&poolmutex);
+
+		return malloc(blocksize);
+	}
+
+	int c = sizeclass(blocksize);
+
+	pthread_mutex_lock(&poolmutex);
+
+	FreeBlock* block = pool[c];
+
+	if(block != NULL) {
+		pool[c] = block->next;
+		poolstats.cached -= blocksize;
+		poolstats.hits++;
+		pthread_mutex_unlock(&poolmutex);
+
+		return block;
+	}
+
+	poolstats.misses++;
+	pthread_mutex_unlock(&poolmutex);
+
+	return malloc(blocksize);
+}
+
+void MsgPacketPool::release(void* block, uint32_t blocksize) {
+	if(block == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&poolmutex);
+
+	if(blocksize > (1U << MaxClassShift) || blocksize != capacity(blocksize) || poolstats.cached + blocksize > poollimit) {
+		poolstats.discards++;
+		pthread_mutex_unlock(&poolmutex);
+
+		free(block);
+		return;
+	}
+
+	int c = sizeclass(blocksize);
+
+	FreeBlock* b = (FreeBlock*)block;
+	b->next = pool[c];
+	pool[c] = b;
+
+	poolstats.cached += blocksize;
+	poolstats.returns++;
+
+	pthread_mutex_unlock(&poolmutex);
+}
+
+void MsgPacketPool::getStatistics(Statistics& stats) {
+	pthread_mutex_lock(&poolmutex);
+	stats = poolstats;
+	pthread_mutex_unlock(&poolmutex);
+}
+
+void MsgPacketPool::resetStatistics() {
+	pthread_mutex_lock(&poolmutex);
+	poolstats.hits = 0;
+	poolstats.misses = 0;
+	poolstats.returns = 0;
+	poolstats.discards = 0;
+	pthread_mutex_unlock(&poolmutex);
+}
+
+void MsgPacketPool::setLimit(size_t bytes) {
+	pthread_mutex_lock(&poolmutex);
+	poollimit = bytes;
+	pthread_mutex_unlock(&poolmutex);
+}
+
+void MsgPacketPool::clear() {
+	pthread_mutex_lock(&poolmutex);
+
+	for(int c = 0; c < CLASS_COUNT; c++) {
+		while(pool[c] != NULL) {
+			FreeBlock* b = pool[c];
+			pool[c] = b->next;
+			free(b);
+		}
+	}
+
+	poolstats.cached = 0;
+
+	pthread_mutex_unlock(&poolmutex);
+}
@@ -81,6 +81,11 @@ bool pollfd(int fd, int timeout_ms, bool in) {
 	return (select(fd + 1, NULL, &fds, NULL, &tv) > 0);
 }
 
+int pollwakeup(int fd, int wakeupfd, int timeout_ms) {
+	// there's no wakeup descriptor, shutdown() interrupts select
+	return pollfd(fd, timeout_ms, true) ? 1 : 0;
+}
+
 void setsock_keepalive(int sock) {
   struct tcp_keepalive param;
   param.onoff = 1;
@@ -117,6 +122,22 @@ bool pollfd(int fd, int timeout_ms, bool in) {
 	return (::poll(&p, 1, timeout_ms) > 0);
 }
 
+int pollwakeup(int fd, int wakeupfd, int timeout_ms) {
+	struct pollfd p[2];
+	p[0].fd = fd;
+	p[0].events = POLLIN;
+	p[0].revents = 0;
+	p[1].fd = wakeupfd;
+	p[1].events = POLLIN;
+	p[1].revents = 0;
+
+	if(::poll(p, (wakeupfd != INVALID_SOCKET) ? 2 : 1, timeout_ms) <= 0) {
+		return 0;
+	}
+
+	return (p[1].revents != 0) ? -1 : 1;
+}
+
 void setsock_keepalive(int sock) {
   int val = 1;
   setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, (sockval_t*)&val, sizeof(val));
@@ -112,6 +112,7 @@ uint16_t be16toh(uint16_t u);
 #endif
 
 bool pollfd(int fd, int timeout_ms, bool in);
+int pollwakeup(int fd, int wakeupfd, int timeout_ms);
 bool setsock_nonblock(int fd, bool nonblock = true);
 void setsock_keepalive(int fd);
 int socketread(int fd, uint8_t* data, int datalen, int timeout_ms);
@@ -29,11 +29,23 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/time.h>
+#endif
 
 #include <set>
 
 #include "packetbuffermodel.h"
+#include "xvdr/thread.h"
 
+#ifdef WIN32
+
+// ring file written through the file descriptor (no mmap)
 template<class PBufferType>
 class FileNode : public Node {
 protected:
@@ -170,6 +182,10 @@ public:
     return m_timeout;
   }
 
+  bool valid() {
+    return m_fd != -1;
+  }
+
 private:
 
   std::string m_filename;
@@ -181,78 +197,724 @@ private:
   std::set<DiskNode*> m_used;
 };
 
+#endif // WIN32
 
-class MemNode : public Node {
+// packets are stored back-to-back in one preallocated ring
+class RingPacketBuffer : public PacketBuffer {
 public:
 
-  MemNode(MsgPacket* packet, PacketBuffer* buffer) : Node(packet, buffer) {}
+  RingPacketBuffer(size_t max_size) :
+  m_data(NULL),
+  m_capacity(0),
+  m_allocated(true),
+  m_write(0),
+  m_first(0),
+  m_current(0),
+  m_unordered(0) {
+    _max_size = max_size;
+    m_data = (uint8_t*)malloc(max_size);
+
+    if(m_data != NULL) {
+      m_capacity = max_size;
+    }
+  }
 
-  size_t size() {
-    if(_packet == NULL) {
-      return 0;
+  virtual ~RingPacketBuffer() {
+    while(!m_views.empty()) {
+      delete m_views.front().packet;
+      m_views.pop_front();
+    }
+
+    if(m_allocated) {
+      free(m_data);
     }
-    return _packet->getPacketLength();
   }
 
-  uint8_t frametype() {
-    if(_packet == NULL) {
-      return 0;
+  void put(MsgPacket* p) {
+    uint32_t length = p->getPacketLength();
+
+    if(length > limit()) {
+      delete p;
+      return;
+    }
+
+    // packets never wrap, skip the remaining space at the end of the ring
+    uint64_t position = m_write;
+    uint64_t offset = position % m_capacity;
+
+    if(offset + length > m_capacity) {
+      position += m_capacity - offset;
+    }
+
+    ensure_size(position + length);
+
+    // don't overwrite packets the reader still refers to
+    if(!writable(position + length)) {
+      delete p;
+      return;
+    }
+
+    Entry e;
+    e.position = position;
+    e.pts = 0;
+    e.length = length;
+    e.frametype = p->getClientID() & 0xFF;
+
+    if(p->getMsgID() == XVDR_STREAM_MUXPKT) {
+      p->rewind();
+      p->get_U16();
+      e.pts = p->get_S64();
+    }
+
+    store(p, position);
+    m_write = position + length;
+
+    if(e.frametype == 1) {
+      if(!m_keyframes.empty() && e.pts < m_keyframes.back().pts) {
+        m_unordered++;
+      }
+
+      KeyFrame k = { e.pts, m_first + m_index.size() };
+      m_keyframes.push_back(k);
     }
-    return _packet->getClientID() && 0xFF;
+
+    m_index.push_back(e);
   }
 
-  int64_t pts() {
-    if(_packet == NULL) {
-      return 0;
+  MsgPacket* get() {
+    if(m_current >= m_first + m_index.size()) {
+      return NULL;
     }
 
-    if(_packet->getMsgID() == XVDR_STREAM_MUXPKT) {
-      _packet->rewind();
-      _packet->get_U16();
-      int64_t pts = _packet->get_S64();
-      _packet->rewind();
-      return pts;
+    Entry& e = m_index[m_current - m_first];
+    MsgPacket* p = load(e.position, e.length);
+
+    if(p == NULL) {
+      return NULL;
     }
 
-    return 0;
+    View v = { p, e.position };
+    m_views.push_back(v);
+    m_current++;
+
+    return p;
   }
 
-  int64_t dts() {
-    if(_packet == NULL) {
-      return 0;
+  void release(MsgPacket* p) {
+    for(std::deque<View>::iterator i = m_views.begin(); i != m_views.end(); i++) {
+      if(i->packet == p) {
+        uint64_t position = i->position;
+        m_views.erase(i);
+        unload(p, position);
+        return;
+      }
+    }
+
+    delete p;
+  }
+
+  bool seek(int time, bool backwards, double* startpts) {
+    int64_t t = (int64_t)time * 1000;
+    *startpts = t;
+
+    uint64_t end = m_first + m_index.size();
+
+    // nothing to skip forward if everything has been read
+    if(!backwards && m_current >= end) {
+      return false;
     }
 
-    if(_packet->getMsgID() == XVDR_STREAM_MUXPKT) {
-      _packet->rewind();
-      _packet->get_U16();
-      _packet->get_S64();
-      int64_t dts = _packet->get_S64();
-      _packet->rewind();
-      return dts;
+    // the binary search needs ascending timestamps
+    if(m_unordered > 0) {
+      return seek_linear(t, backwards, startpts);
     }
 
-    return 0;
+    KeyFrame k = { t, m_current };
+    size_t i = 0;
+
+    // rewind: last keyframe at or before the time, in front of the current packet
+    if(backwards) {
+      size_t last = std::lower_bound(m_keyframes.begin(), m_keyframes.end(), k, KeyFrame::before) - m_keyframes.begin();
+      i = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), k, KeyFrame::earlier) - m_keyframes.begin();
+
+      if(i > last) {
+        i = last;
+      }
+      if(i == 0) {
+        return false;
+      }
+
+      i--;
+    }
+    // fast-forward: first keyframe at or after the time, behind the current packet
+    else {
+      size_t first = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), k, KeyFrame::before) - m_keyframes.begin();
+      i = std::lower_bound(m_keyframes.begin(), m_keyframes.end(), k, KeyFrame::earlier) - m_keyframes.begin();
+
+      if(i < first) {
+        i = first;
+      }
+      if(i >= m_keyframes.size()) {
+        return false;
+      }
+    }
+
+    m_current = m_keyframes[i].sequence;
+    *startpts = m_keyframes[i].pts;
+
+    return true;
   }
+
+  void clear() {
+    // positions keep running, packets in use must not be overwritten
+    m_first += m_index.size();
+    m_current = m_first;
+
+    m_index.clear();
+    m_keyframes.clear();
+    m_unordered = 0;
+  }
+
+  size_t size() {
+    return m_index.empty() ? 0 : (size_t)(m_write - m_index.front().position);
+  }
+
+  size_t count() {
+    return m_index.size();
+  }
+
+  // the storage has been set up
+  bool valid() {
+    return m_capacity > 0;
+  }
+
+protected:
+
+  // storage is provided by a derived class
+  RingPacketBuffer() :
+  m_data(NULL),
+  m_capacity(0),
+  m_allocated(false),
+  m_write(0),
+  m_first(0),
+  m_current(0),
+  m_unordered(0) {
+  }
+
+  void attach(uint8_t* data, size_t capacity) {
+    m_data = data;
+    m_capacity = capacity;
+  }
+
+  // copy a packet to its position in the ring (takes the ownership of the packet)
+  virtual void store(MsgPacket* p, uint64_t position) {
+    memcpy(m_data + (position % m_capacity), p->getPacket(), p->getPacketLength());
+    delete p;
+  }
+
+  // packet referring to the stored data
+  virtual MsgPacket* load(uint64_t position, uint32_t length) {
+    return MsgPacket::attach(m_data + (position % m_capacity), length);
+  }
+
+  // packet returned by load() isn't used anymore
+  virtual void unload(MsgPacket* p, uint64_t /*position*/) {
+    delete p;
+  }
+
+  inline uint8_t* data() {
+    return m_data;
+  }
+
+  inline size_t capacity() {
+    return m_capacity;
+  }
+
+private:
+
+  // index entry of a packet in the ring
+  struct Entry {
+    uint64_t position;
+    int64_t pts;
+    uint32_t length;
+    uint8_t frametype;
+  };
+
+  struct KeyFrame {
+    int64_t pts;
+    uint64_t sequence;
+
+    static bool earlier(const KeyFrame& a, const KeyFrame& b) {
+      return a.pts < b.pts;
+    }
+
+    static bool before(const KeyFrame& a, const KeyFrame& b) {
+      return a.sequence < b.sequence;
+    }
+  };
+
+  // packet returned by get() referring to the ring
+  struct View {
+    MsgPacket* packet;
+    uint64_t position;
+  };
+
+  // the ring can't grow beyond the preallocated memory
+  size_t limit() {
+    return std::min(get_max_size(), m_capacity);
+  }
+
+  // drop the oldest packets until the ring holds everything up to end
+  void ensure_size(uint64_t end) {
+    size_t max = limit();
+
+    while(!m_index.empty() && end - m_index.front().position > max) {
+      if(!m_keyframes.empty() && m_keyframes.front().sequence == m_first) {
+        if(m_keyframes.size() > 1 && m_keyframes[1].pts < m_keyframes[0].pts) {
+          m_unordered--;
+        }
+
+        m_keyframes.pop_front();
+      }
+
+      m_index.pop_front();
+      m_first++;
+    }
+
+    if(m_current < m_first) {
+      m_current = m_first;
+    }
+  }
+
+  bool writable(uint64_t end) {
+    for(std::deque<View>::iterator i = m_views.begin(); i != m_views.end(); i++) {
+      if(end - i->position > m_capacity) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool seek_linear(int64_t t, bool backwards, double* startpts) {
+    uint64_t end = m_first + m_index.size();
+
+    // rewind
+    if(backwards) {
+      for(uint64_t i = std::min(m_current, end); i-- > m_first;) {
+        Entry& e = m_index[i - m_first];
+
+        if(e.frametype == 1 && t >= e.pts) {
+          m_current = i;
+          *startpts = e.pts;
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    // fast-forward
+    for(uint64_t i = m_current + 1; i < end; i++) {
+      Entry& e = m_index[i - m_first];
+
+      if(e.frametype == 1 && t <= e.pts) {
+        m_current = i;
+        *startpts = e.pts;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  uint8_t* m_data;
+
+  size_t m_capacity;
+
+  bool m_allocated;
+
+  // logical (free running) write position in the ring
+  uint64_t m_write;
+
+  // sequence number of the first packet in the index
+  uint64_t m_first;
+
+  // sequence number of the next packet returned by get()
+  uint64_t m_current;
+
+  std::deque<Entry> m_index;
+
+  std::deque<KeyFrame> m_keyframes;
+
+  std::deque<View> m_views;
+
+  size_t m_unordered;
 };
 
-class MemPacketBuffer : public PacketBufferModel<MemNode> {
+
+#ifndef WIN32
+
+// ring in a preallocated, memory mapped file
+// packets are written by a background thread and read through the mapping
+class DiskPacketBuffer : public RingPacketBuffer, public Thread {
 public:
-  MemPacketBuffer(size_t max_mem) : PacketBufferModel<MemNode>::PacketBufferModel(max_mem) {};
+
+  DiskPacketBuffer(size_t max_size, const std::string& file) : m_fd(-1), m_written(0), m_queuedbytes(0) {
+    _max_size = max_size;
+    m_filename = file;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    m_fd = open(m_filename.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+
+    if(m_fd == -1) {
+      return;
+    }
+
+    // allocate all blocks now, the mapping of a sparse file fails on a full disk
+    if(posix_fallocate(m_fd, 0, max_size) != 0) {
+      return;
+    }
+
+    // without a mapping (e.g. address space of 32 bit systems) packets are read from the file
+    void* data = mmap(NULL, max_size, PROT_READ, MAP_SHARED, m_fd, 0);
+
+    attach((data != MAP_FAILED) ? (uint8_t*)data : NULL, max_size);
+
+    // queued data must never catch up with packets still in the ring
+    m_maxqueued = std::min((size_t)MaxQueueSize, max_size / 4);
+
+    Start();
+  }
+
+  virtual ~DiskPacketBuffer() {
+    Cancel(-1);
+    m_event.Signal();
+    Cancel(5);
+
+    while(!m_queue.empty()) {
+      delete m_queue.front().packet;
+      m_queue.pop_front();
+    }
+
+    if(data() != NULL) {
+      munmap(data(), capacity());
+    }
+
+    if(m_fd != -1) {
+      close(m_fd);
+      unlink(m_filename.c_str());
+    }
+  }
+
+  void getStatistics(Statistics& s) {
+    MutexLock lock(&m_lock);
+    s = m_stats;
+    s.queued = m_queue.size() - m_written;
+    s.queuedbytes = m_queuedbytes;
+  }
+
+protected:
+
+  void store(MsgPacket* p, uint64_t position) {
+    MutexLock lock(&m_lock);
+    uint32_t length = p->getPacketLength();
+
+    // the disk doesn't keep up, wait for the writer
+    if(m_queuedbytes + length > m_maxqueued) {
+      m_stats.stalls++;
+
+      while(m_queuedbytes + length > m_maxqueued && Running()) {
+        m_lock.Unlock();
+        m_drained.Wait(100);
+        m_lock.Lock();
+      }
+    }
+
+    Pending e = { p, position, 0 };
+    m_queue.push_back(e);
+    m_queuedbytes += length;
+
+    size_t queued = m_queue.size() - m_written;
+
+    if(queued > m_stats.maxqueued) {
+      m_stats.maxqueued = queued;
+    }
+
+    // wake the writer for the first packet and full batches
+    if(queued == 1) {
+      m_flush.Set(FlushInterval);
+      m_event.Signal();
+    }
+    else if(m_queuedbytes >= BatchSize) {
+      m_event.Signal();
+    }
+  }
+
+  MsgPacket* load(uint64_t position, uint32_t length) {
+    MutexLock lock(&m_lock);
+    Pending* e = find(position);
+
+    // not written yet, read from memory
+    if(e != NULL) {
+      e->refs++;
+      return MsgPacket::attach(e->packet->getPacket(), length);
+    }
+
+    if(data() == NULL) {
+      return read(position % capacity(), length);
+    }
+
+    return RingPacketBuffer::load(position, length);
+  }
+
+  void unload(MsgPacket* p, uint64_t position) {
+    delete p;
+
+    MutexLock lock(&m_lock);
+    Pending* e = find(position);
+
+    if(e != NULL) {
+      e->refs--;
+    }
+
+    purge();
+  }
+
+  void Action() {
+    struct iovec iov[BatchCount];
+
+    while(Running()) {
+      m_lock.Lock();
+
+      // collect a batch of packets stored back-to-back in the file
+      size_t first = m_written;
+      size_t count = 0;
+      size_t bytes = 0;
+      uint64_t position = 0;
+
+      bool full = false;
+
+      while(first + count < m_queue.size() && count < BatchCount && bytes < BatchSize) {
+        Pending& e = m_queue[first + count];
+        uint32_t length = e.packet->getPacketLength();
+
+        if(count == 0) {
+          position = e.position;
+        }
+        // skipped space at the end of the ring
+        else if(e.position != position + bytes) {
+          full = true;
+          break;
+        }
+
+        iov[count].iov_base = e.packet->getPacket();
+        iov[count].iov_len = length;
+
+        bytes += length;
+        count++;
+      }
+
+      full = full || count == BatchCount || bytes >= BatchSize || m_queuedbytes >= m_maxqueued / 2;
+      bool due = m_flush.TimedOut();
+
+      m_lock.Unlock();
+
+      if(count == 0) {
+        m_event.Wait(1000);
+        continue;
+      }
+
+      // let small batches grow
+      if(!full && !due) {
+        m_event.Wait(FlushInterval);
+        continue;
+      }
+
+      uint64_t start = now();
+      bool rc = write(iov, count, position % capacity());
+      uint64_t latency = now() - start;
+
+      MutexLock lock(&m_lock);
+
+      m_written += count;
+      m_queuedbytes -= bytes;
+
+      m_stats.writes++;
+      m_stats.latency += latency;
+
+      if(rc) {
+        m_stats.written += bytes;
+      }
+      else {
+        m_stats.errors++;
+      }
+
+      if(latency > m_stats.maxlatency) {
+        m_stats.maxlatency = latency;
+      }
+
+      purge();
+      m_drained.Signal();
+    }
+  }
+
+private:
+
+  // packet waiting to be written (or still referred by the reader)
+  struct Pending {
+    MsgPacket* packet;
+    uint64_t position;
+    int refs;
+
+    static bool before(const Pending& a, const Pending& b) {
+      return a.position < b.position;
+    }
+  };
+
+  static uint64_t now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+  }
+
+  Pending* find(uint64_t position) {
+    if(m_queue.empty() || position < m_queue.front().position || position > m_queue.back().position) {
+      return NULL;
+    }
+
+    // positions are ascending
+    Pending k = { NULL, position, 0 };
+    std::deque<Pending>::iterator i = std::lower_bound(m_queue.begin(), m_queue.end(), k, Pending::before);
+
+    if(i == m_queue.end() || i->position != position) {
+      return NULL;
+    }
+
+    return &(*i);
+  }
+
+  // drop written packets which aren't used by the reader
+  void purge() {
+    while(m_written > 0 && m_queue.front().refs == 0) {
+      delete m_queue.front().packet;
+      m_queue.pop_front();
+      m_written--;
+    }
+  }
+
+  bool write(struct iovec* iov, int count, off_t offset) {
+    while(count > 0) {
+      ssize_t rc = pwritev(m_fd, iov, count, offset);
+
+      if(rc < 0 && errno == EINTR) {
+        continue;
+      }
+      if(rc <= 0) {
+        return false;
+      }
+
+      offset += rc;
+
+      // partial write
+      while(count > 0 && (size_t)rc >= iov->iov_len) {
+        rc -= iov->iov_len;
+        iov++;
+        count--;
+      }
+
+      if(count > 0) {
+        iov->iov_base = (uint8_t*)iov->iov_base + rc;
+        iov->iov_len -= rc;
+      }
+    }
+
+    return true;
+  }
+
+  // copy of a stored packet (the file isn't mapped)
+  MsgPacket* read(off_t offset, uint32_t length) {
+    MsgPacket* p = new MsgPacket;
+
+    if(p->reserve(length - MsgPacket::HeaderLength) == NULL) {
+      delete p;
+      return NULL;
+    }
+
+    uint8_t* data = p->getPacket();
+
+    while(length > 0) {
+      ssize_t rc = pread(m_fd, data, length, offset);
+
+      if(rc < 0 && errno == EINTR) {
+        continue;
+      }
+      if(rc <= 0) {
+        delete p;
+        return NULL;
+      }
+
+      data += rc;
+      offset += rc;
+      length -= rc;
+    }
+
+    return p;
+  }
+
+  std::string m_filename;
+
+  int m_fd;
+
+  std::deque<Pending> m_queue;
+
+  // number of written packets at the front of the queue
+  size_t m_written;
+
+  size_t m_queuedbytes;
+
+  size_t m_maxqueued;
+
+  Statistics m_stats;
+
+  TimeMs m_flush;
+
+  Mutex m_lock;
+
+  CondWait m_event;
+
+  CondWait m_drained;
+
+  enum {
+    BatchCount = 256,                   /* !< maximum number of packets written at once */
+    BatchSize = 1024 * 1024,            /* !< maximum size of a write batch in bytes */
+    MaxQueueSize = 16 * 1024 * 1024,    /* !< maximum number of bytes waiting to be written */
+    FlushInterval = 20                  /* !< time (ms) a small batch waits for more packets */
+  };
 };
 
+#endif // WIN32
+
 
 namespace XVDR {
 
-PacketBuffer* PacketBuffer::create(size_t max_size, const std::string& file) {
-  PacketBuffer* buf = NULL;
+template<class T>
+static PacketBuffer* validate(T* buf) {
+  // the memory or the file couldn't be allocated
+  if (!buf->valid()) {
+    delete buf;
+    return NULL;
+  }
+
+  return buf;
+}
 
+PacketBuffer* PacketBuffer::create(size_t max_size, const std::string& file) {
   if (!file.empty()) {
-    buf = new DiskPacketBuffer(max_size, file);
-  } else {
-    buf = new MemPacketBuffer(max_size);
+    return validate(new DiskPacketBuffer(max_size, file));
   }
 
-  return buf;
+  return validate(new RingPacketBuffer(max_size));
 }
 
 } // namespace XVDR
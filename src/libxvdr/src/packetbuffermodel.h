@@ -26,6 +26,12 @@
 
 #include "xvdr/packetbuffer.h"
 #include "xvdr/command.h"
+#include "xvdr/msgpacketpool.h"
+
+#include <deque>
+#include <algorithm>
+
+#include <new>
 
 using namespace XVDR;
 
@@ -34,17 +40,34 @@ public:
   Node* _next;
   Node* _prev;
   MsgPacket* _packet;
+  uint64_t _sequence;
 
   Node(MsgPacket* packet, PacketBuffer* buffer) {
     _packet = packet;
     _prev = NULL;
     _next = NULL;
+    _sequence = 0;
   }
 
   virtual ~Node() {
     delete _packet;
   }
 
+  // nodes are recycled through the packet pool
+  static void* operator new(size_t size) {
+    void* p = MsgPacketPool::acquire(size);
+
+    if(p == NULL) {
+      throw std::bad_alloc();
+    }
+
+    return p;
+  }
+
+  static void operator delete(void* p, size_t size) {
+    MsgPacketPool::release(p, MsgPacketPool::capacity(size));
+  }
+
   virtual size_t size() = 0;
 
   virtual uint8_t frametype() = 0;
@@ -74,6 +97,8 @@ public:
     _current = NULL;
     _current_last = NULL;
     _max_size = max_size;
+    _sequence = 0;
+    _unordered = 0;
   }
 
   ~PacketBufferModel() {
@@ -86,6 +111,12 @@ public:
     size_t size = n->size();
     ensure_size(size);
 
+    n->_sequence = _sequence++;
+
+    if(n->frametype() == 1) {
+      index_add(n);
+    }
+
     if (_tail == NULL) {
       _head = _tail = _current = n;
     }
@@ -146,11 +177,70 @@ public:
   }
 
   bool seek(int time, bool backwards, double *startpts) {
-    NodeType* p = NULL;
-
     int64_t t = (int64_t)time * 1000;
     *startpts = t;
 
+    // the binary search needs ascending timestamps
+    if(_unordered > 0) {
+      return seek_linear(t, backwards, startpts);
+    }
+
+    // keyframes in front of / behind the current position
+    size_t first = 0;
+    size_t last = _index.size();
+
+    if(_current != NULL) {
+      KeyFrame k = { 0, _current->_sequence, NULL };
+      size_t pos = std::lower_bound(_index.begin(), _index.end(), k, KeyFrame::before) - _index.begin();
+
+      if(backwards) {
+        last = pos;
+      }
+      else {
+        first = (pos < _index.size() && _index[pos].node == _current) ? pos + 1 : pos;
+      }
+    }
+    else if(!backwards) {
+      return false;
+    }
+
+    KeyFrame k = { t, 0, NULL };
+    size_t i = 0;
+
+    // rewind: last keyframe at or before the time
+    if(backwards) {
+      i = std::upper_bound(_index.begin(), _index.end(), k, KeyFrame::earlier) - _index.begin();
+
+      if(i > last) {
+        i = last;
+      }
+      if(i == 0) {
+        return false;
+      }
+
+      i--;
+    }
+    // fast-forward: first keyframe at or after the time
+    else {
+      i = std::lower_bound(_index.begin(), _index.end(), k, KeyFrame::earlier) - _index.begin();
+
+      if(i < first) {
+        i = first;
+      }
+      if(i >= last) {
+        return false;
+      }
+    }
+
+    _current = _index[i].node;
+    *startpts = _index[i].pts;
+
+    return true;
+  }
+
+  bool seek_linear(int64_t t, bool backwards, double *startpts) {
+    NodeType* p = NULL;
+
     current_push();
 
     // rewind
@@ -187,6 +277,9 @@ public:
 
     _size = _count = 0;
     _head = _tail = _current = NULL;
+
+    _index.clear();
+    _unordered = 0;
   }
 
   inline size_t size() {
@@ -208,6 +301,22 @@ protected:
   }
 
 private:
+
+  // keyframe entry of the seek index
+  struct KeyFrame {
+    int64_t pts;
+    uint64_t sequence;
+    NodeType* node;
+
+    static bool earlier(const KeyFrame& a, const KeyFrame& b) {
+      return a.pts < b.pts;
+    }
+
+    static bool before(const KeyFrame& a, const KeyFrame& b) {
+      return a.sequence < b.sequence;
+    }
+  };
+
   size_t _size;
   size_t _count;
   NodeType* _head;
@@ -215,6 +324,35 @@ private:
   NodeType* _current;
   NodeType* _current_last;
 
+  // keyframes in buffer order
+  std::deque<KeyFrame> _index;
+  uint64_t _sequence;
+
+  // number of timestamp discontinuities in the index
+  size_t _unordered;
+
+  void index_add(NodeType* n) {
+    KeyFrame k = { n->pts(), n->_sequence, n };
+
+    if(!_index.empty() && k.pts < _index.back().pts) {
+      _unordered++;
+    }
+
+    _index.push_back(k);
+  }
+
+  void index_remove(NodeType* n) {
+    if(_index.empty() || _index.front().node != n) {
+      return;
+    }
+
+    if(_index.size() > 1 && _index[1].pts < _index[0].pts) {
+      _unordered--;
+    }
+
+    _index.pop_front();
+  }
+
   void ensure_size(uint32_t size) {
     size_t max = get_max_size();
 
@@ -232,6 +370,7 @@ private:
         _head->_prev = NULL;
       }
 
+      index_remove(n);
       delete n;
       _count--;
       _size -= node_size;
@@ -0,0 +1,350 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+
+#include "os-config.h"
+#include "crc32.h"
+#include "packetreader.h"
+#include "xvdr/msgpacket.h"
+#include "xvdr/session.h"
+
+using namespace XVDR;
+
+PacketReader::PacketReader(uint32_t size) : m_buffer(NULL), m_size(size), m_head(0), m_tail(0), m_wakeupfd(INVALID_SOCKET),
+	m_packet(NULL), m_data(NULL), m_length(0), m_received(0), m_remaining(0), m_crc(0) {
+	m_buffer = (uint8_t*)malloc(m_size);
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+PacketReader::~PacketReader() {
+	discard();
+	free(m_buffer);
+}
+
+void PacketReader::reset() {
+	discard();
+	m_head = 0;
+	m_tail = 0;
+}
+
+void PacketReader::discard() {
+	delete m_packet;
+	m_packet = NULL;
+	m_data = NULL;
+}
+
+void PacketReader::setWakeup(int fd) {
+	m_wakeupfd = fd;
+}
+
+void PacketReader::getStatistics(Statistics& stats) {
+	stats = m_stats;
+}
+
+int PacketReader::receive(int fd, uint8_t* data, uint32_t datalen, int timeout_ms) {
+#ifdef WIN32
+	// MSG_DONTWAIT isn't available, always wait for data
+	bool wait = true;
+#else
+	bool wait = false;
+#endif
+
+	for(;;) {
+		if(wait) {
+			m_stats.pollcalls++;
+
+			int rc = pollwakeup(fd, m_wakeupfd, timeout_ms);
+
+			if(rc == 0) {
+				return -ETIMEDOUT;
+			}
+
+			// session has been aborted
+			if(rc < 0) {
+				return -EINTR;
+			}
+		}
+
+		int rc = recv(fd, (char*)data, datalen, MSG_DONTWAIT);
+		m_stats.recvcalls++;
+
+		if(rc == -1 && sockerror() == ENOTSOCK) {
+			// plain filedescriptors can only be read after poll
+			if(!wait) {
+				wait = true;
+				continue;
+			}
+
+			rc = ::read(fd, data, datalen);
+		}
+
+		if(rc > 0) {
+			m_stats.bytes += rc;
+			return rc;
+		}
+
+		if(rc == 0) {
+			return -ECONNRESET;
+		}
+
+		if(sockerror() != SEWOULDBLOCK) {
+			return -sockerror();
+		}
+
+		wait = true;
+	}
+}
+
+int PacketReader::fill(int fd, uint32_t bytes, int timeout_ms) {
+	if(available() >= bytes) {
+		return 0;
+	}
+
+	// move remaining data to the front
+	if(m_size - m_head < bytes) {
+		memmove(m_buffer, m_buffer + m_head, available());
+		m_tail -= m_head;
+		m_head = 0;
+	}
+
+	while(available() < bytes) {
+		int rc = receive(fd, m_buffer + m_tail, m_size - m_tail, timeout_ms);
+
+		if(rc < 0) {
+			return -rc;
+		}
+
+		m_tail += rc;
+	}
+
+	return 0;
+}
+
+int PacketReader::receivePayload(int fd, int timeout_ms) {
+	// copy buffered data
+	uint32_t length = m_length - m_received;
+
+	if(available() < length) {
+		length = available();
+	}
+
+	memcpy(m_data + m_received, m_buffer + m_head, length);
+	m_received += length;
+	m_head += length;
+
+	if(m_head == m_tail) {
+		m_head = 0;
+		m_tail = 0;
+	}
+
+	// receive the rest directly into the destination
+	while(m_received < m_length) {
+		int rc = receive(fd, m_data + m_received, m_length - m_received, timeout_ms);
+
+		if(rc < 0) {
+			return -rc;
+		}
+
+		m_received += rc;
+	}
+
+	return 0;
+}
+
+MsgPacket* PacketReader::read(int fd, bool& closed, int timeout_ms, Session* session) {
+	if(m_buffer == NULL) {
+		return NULL;
+	}
+
+	// continue the payload of a packet interrupted by a timeout
+	if(m_packet != NULL) {
+		return readPayload(fd, closed, timeout_ms, session);
+	}
+
+	// try to find sync
+	int rc = 0;
+
+	while((rc = fill(fd, sizeof(uint32_t), timeout_ms)) == 0) {
+		uint32_t sync = 0;
+		memcpy(&sync, m_buffer + m_head, sizeof(sync));
+
+		if(be32toh(sync) == 0xAAAAAA) {
+			break;
+		}
+
+		m_head++;
+	}
+
+	// read remaining header bytes
+	if(rc == 0) {
+		rc = fill(fd, MsgPacket::HeaderLength, timeout_ms);
+	}
+
+	// not found / timeout
+	if(rc != 0) {
+		closed = (rc == ECONNRESET);
+		return NULL;
+	}
+
+	// header validation
+	uint8_t* header = m_buffer + m_head;
+	uint32_t checksum = 0;
+	uint32_t datalen = 0;
+
+	memcpy(&checksum, header + MsgPacket::CheckSumPos, sizeof(checksum));
+	memcpy(&datalen, header + MsgPacket::PayloadLengthPos, sizeof(datalen));
+
+	checksum = be32toh(checksum);
+	datalen = be32toh(datalen);
+	uint32_t test = CRC32::compute(header, MsgPacket::CheckSumPos);
+
+	if(checksum != test) {
+		std::cerr << "checksum failed !" << std::endl;
+		std::cerr << "PACKET CHECKSUM  : " << std::hex << checksum << std::endl;
+		std::cerr << "COMPUTED CHECKSUM: " << std::hex << test << std::endl;
+
+		// skip sync and search for the next packet
+		m_head += sizeof(uint32_t);
+		return NULL;
+	}
+
+	// wait for the complete packet if it fits into the buffer
+	if(MsgPacket::HeaderLength + datalen <= m_size) {
+		rc = fill(fd, MsgPacket::HeaderLength + datalen, timeout_ms);
+
+		if(rc != 0) {
+			closed = (rc == ECONNRESET);
+			return NULL;
+		}
+
+		header = m_buffer + m_head;
+	}
+
+	MsgPacket* p = new MsgPacket(0, 0, 1);
+
+	if(p->getPacket() == NULL) {
+		delete p;
+		return NULL;
+	}
+
+	memcpy(p->getPacket(), header, MsgPacket::HeaderLength);
+	m_head += MsgPacket::HeaderLength;
+
+	// no payload ?
+	if(datalen == 0) {
+		m_stats.packets++;
+		return p;
+	}
+
+	// payload checksum (0 = disabled)
+	if(p->getPayloadCheckSum() == 0) {
+		p->disablePayloadCheckSum();
+	}
+
+	// leading payload bytes kept in the packet
+	uint32_t prefix = (session != NULL) ? session->GetPayloadPrefix(p) : 0;
+
+	if(prefix == 0 || prefix > datalen) {
+		prefix = datalen;
+	}
+
+	uint8_t* data = p->reserve(prefix);
+
+	if(data == NULL) {
+		delete p;
+		return NULL;
+	}
+
+	m_packet = p;
+	m_data = data;
+	m_length = prefix;
+	m_received = 0;
+	m_remaining = datalen - prefix;
+	m_crc = 0;
+
+	return readPayload(fd, closed, timeout_ms, session);
+}
+
+MsgPacket* PacketReader::readPayload(int fd, bool& closed, int timeout_ms, Session* session) {
+	uint32_t plcs = m_packet->getPayloadCheckSum();
+
+	for(;;) {
+		int rc = receivePayload(fd, timeout_ms);
+
+		// the packet is kept until the next call on timeout
+		if(rc == ETIMEDOUT) {
+			return NULL;
+		}
+
+		if(rc != 0) {
+			closed = (rc == ECONNRESET);
+			discard();
+			return NULL;
+		}
+
+		if(plcs != 0) {
+			m_crc = CRC32::update(m_crc, m_data, m_length);
+		}
+
+		if(m_remaining == 0) {
+			break;
+		}
+
+		// remaining payload
+		uint8_t* data = session->GetPayloadBuffer(m_packet, m_remaining);
+
+		if(data == NULL) {
+			data = m_packet->reserve(m_remaining);
+		}
+
+		if(data == NULL) {
+			discard();
+			return NULL;
+		}
+
+		m_data = data;
+		m_length = m_remaining;
+		m_received = 0;
+		m_remaining = 0;
+	}
+
+	MsgPacket* p = m_packet;
+	m_packet = NULL;
+	m_data = NULL;
+
+	// payload checksum validation
+	if(plcs != 0 && plcs != m_crc) {
+		std::cerr << "wrong payload checksum !" << std::endl;
+		delete p;
+		return NULL;
+	}
+
+	m_stats.packets++;
+	return p;
+}
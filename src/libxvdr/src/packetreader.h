@@ -0,0 +1,153 @@
+#pragma once
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/** \file packetreader.h
+	Header file for the PacketReader class.
+	The buffered receiver used to read packets from a session socket.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+class MsgPacket;
+
+namespace XVDR {
+
+class Session;
+
+/**
+	@short Buffered packet reader
+
+	Receives as many bytes as the kernel has available into a receive buffer
+	and slices complete packets out of it. The number of syscalls scales with
+	the number of bytes received rather than the number of packets.
+*/
+
+class PacketReader {
+public:
+
+	/**
+	Reader statistics.
+	*/
+	struct Statistics {
+		uint64_t packets;			/*!< packets returned */
+		uint64_t bytes;				/*!< bytes received */
+		uint64_t recvcalls;			/*!< recv() calls */
+		uint64_t pollcalls;			/*!< poll() calls */
+	};
+
+	/**
+	Constructor.
+
+	@param	size		size of the receive buffer in bytes
+	*/
+	PacketReader(uint32_t size = DefaultBufferSize);
+
+	/**
+	Destructor.
+	*/
+	~PacketReader();
+
+	/**
+	Receive packet from socket.
+	Returns the next complete packet. Incomplete data, including a partially
+	received payload, is kept until the next call.
+
+	@param	fd			filedescriptor of the socket
+	@param	closed		set to true if connection has been closed
+	@param	timeout_ms	read operation timeout in milliseconds
+	@param	session		session providing memory for direct payload reception (may be NULL)
+	@return pointer to new packet or NULL on timeout
+	*/
+	MsgPacket* read(int fd, bool& closed, int timeout_ms = 3000, Session* session = NULL);
+
+	/**
+	Discard all buffered data and a partially received packet.
+	Must be called if the reader is used with a new socket.
+	*/
+	void reset();
+
+	/**
+	Set the wakeup descriptor.
+	A waiting read returns immediately once the descriptor becomes readable.
+
+	@param	fd			filedescriptor to watch (INVALID_SOCKET to disable)
+	*/
+	void setWakeup(int fd);
+
+	/**
+	Get reader statistics.
+
+	@param	stats		structure receiving the current statistics
+	*/
+	void getStatistics(Statistics& stats);
+
+	enum {
+		DefaultBufferSize = 64 * 1024	/*!< default size of the receive buffer */
+	};
+
+private:
+
+	uint32_t available() const {
+		return m_tail - m_head;
+	}
+
+	int fill(int fd, uint32_t bytes, int timeout_ms);
+
+	int receive(int fd, uint8_t* data, uint32_t datalen, int timeout_ms);
+
+	int receivePayload(int fd, int timeout_ms);
+
+	MsgPacket* readPayload(int fd, bool& closed, int timeout_ms, Session* session);
+
+	void discard();
+
+	uint8_t* m_buffer;
+
+	uint32_t m_size;
+
+	uint32_t m_head;
+
+	uint32_t m_tail;
+
+	int m_wakeupfd;
+
+	// packet receiving its payload
+	MsgPacket* m_packet;
+
+	uint8_t* m_data;
+
+	uint32_t m_length;
+
+	uint32_t m_received;
+
+	uint32_t m_remaining;
+
+	uint32_t m_crc;
+
+	Statistics m_stats;
+};
+
+} // namespace XVDR
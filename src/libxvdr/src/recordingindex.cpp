@@ -0,0 +1,231 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include "xvdr/recordingindex.h"
+#include "xvdr/connection.h"
+#include "xvdr/msgpacket.h"
+#include "xvdr/command.h"
+
+using namespace XVDR;
+
+RecordingIndex::RecordingIndex(Connection* connection)
+ : m_connection(connection)
+ , m_invalid(false)
+ , m_lookups(0)
+ , m_requests(0)
+{
+}
+
+void RecordingIndex::Invalidate()
+{
+  __atomic_store_n(&m_invalid, true, __ATOMIC_RELEASE);
+}
+
+bool RecordingIndex::GetKeyFrame(const std::string& recid, uint32_t frame, bool backwards, KeyFrame& keyframe)
+{
+  if(__atomic_exchange_n(&m_invalid, false, __ATOMIC_ACQ_REL))
+    m_recordings.clear();
+
+  KeyFrames& keyframes = m_recordings[recid];
+  m_lookups++;
+
+  if(Lookup(keyframes, frame, backwards, keyframe))
+    return true;
+
+  if(!Request(frame, backwards, keyframe))
+    return false;
+
+  Add(keyframes, keyframe, frame, backwards);
+  return true;
+}
+
+bool RecordingIndex::Lookup(KeyFrames& keyframes, uint32_t frame, bool backwards, KeyFrame& keyframe)
+{
+  KeyFrames::iterator i = keyframes.upper_bound(frame);
+
+  if(backwards)
+  {
+    if(i == keyframes.begin())
+      return false;
+
+    i--;
+
+    // the frame isn't within the known range behind the keyframe
+    if(frame - i->first > i->second.following)
+      return false;
+  }
+  else
+  {
+    // keyframe exactly at the frame
+    if(i != keyframes.begin())
+    {
+      KeyFrames::iterator p = i;
+      p--;
+
+      if(p->first == frame)
+        i = p;
+    }
+
+    if(i == keyframes.end())
+      return false;
+
+    if(i->first != frame)
+    {
+      if(i == keyframes.begin())
+        return false;
+
+      // the frames up to the keyframe have to be known
+      KeyFrames::iterator p = i;
+      p--;
+
+      if(p->first + p->second.following < i->first - 1)
+        return false;
+    }
+  }
+
+  keyframe.frame = i->first;
+  keyframe.position = i->second.position;
+  keyframe.length = i->second.length;
+
+  return true;
+}
+
+bool RecordingIndex::Request(uint32_t frame, bool backwards, KeyFrame& keyframe)
+{
+  // the server searches the keyframe strictly before or after the frame
+  uint32_t query = backwards ? frame + 1 : frame - 1;
+
+  // first frame: search backwards from the next one
+  if(!backwards && frame == 0)
+  {
+    if(Request(0, true, keyframe))
+      return true;
+
+    query = 0;
+  }
+
+  MsgPacket vrp(XVDR_RECSTREAM_GETIFRAME);
+  vrp.put_U32(query);
+  vrp.put_U32(backwards ? 0 : 1);
+
+  m_requests++;
+
+  MsgPacket* vresp = m_connection->ReadResult(&vrp);
+
+  if(vresp == NULL)
+    return false;
+
+  // position, frame number and length (a single U32 if there's no keyframe)
+  if(vresp->getPayloadLength() < 16)
+  {
+    delete vresp;
+    return false;
+  }
+
+  keyframe.position = vresp->get_U64();
+  keyframe.frame = vresp->get_U32();
+  keyframe.length = vresp->get_U32();
+
+  delete vresp;
+  return true;
+}
+
+void RecordingIndex::Add(KeyFrames& keyframes, const KeyFrame& keyframe, uint32_t frame, bool backwards)
+{
+  KeyFrames::iterator i = keyframes.find(keyframe.frame);
+
+  if(i == keyframes.end())
+  {
+    Entry e;
+    e.position = keyframe.position;
+    e.length = keyframe.length;
+    e.following = 0;
+
+    i = keyframes.insert(std::make_pair(keyframe.frame, e)).first;
+  }
+
+  // no keyframes between the keyframe and the frame
+  if(backwards)
+  {
+    if(keyframe.frame <= frame && frame - keyframe.frame > i->second.following)
+      i->second.following = frame - keyframe.frame;
+
+    return;
+  }
+
+  // no keyframes between the frame and the keyframe, extend the range of the keyframe before
+  if(i == keyframes.begin() || keyframe.frame <= frame)
+    return;
+
+  KeyFrames::iterator p = i;
+  p--;
+
+  if(p->first + p->second.following + 1 >= frame)
+    p->second.following = keyframe.frame - 1 - p->first;
+}
+
+int64_t RecordingIndex::FrameToPosition(uint32_t frame)
+{
+  MsgPacket vrp(XVDR_RECSTREAM_FRAMETOPOS);
+  vrp.put_U32(frame);
+
+  MsgPacket* vresp = m_connection->ReadResult(&vrp);
+
+  if(vresp == NULL)
+    return -1;
+
+  int64_t position = (int64_t)vresp->get_U64();
+  delete vresp;
+
+  return position;
+}
+
+int64_t RecordingIndex::PositionToFrame(uint64_t position)
+{
+  MsgPacket vrp(XVDR_RECSTREAM_POSTOFRAME);
+  vrp.put_U64(position);
+
+  MsgPacket* vresp = m_connection->ReadResult(&vrp);
+
+  if(vresp == NULL)
+    return -1;
+
+  int64_t frame = vresp->get_U32();
+  delete vresp;
+
+  return frame;
+}
+
+void RecordingIndex::GetStatistics(const std::string& recid, Statistics& s)
+{
+  s.lookups = m_lookups;
+  s.requests = m_requests;
+  s.keyframes = 0;
+
+  std::map<std::string, KeyFrames>::iterator i = m_recordings.find(recid);
+
+  if(i != m_recordings.end())
+    s.keyframes = i->second.size();
+}
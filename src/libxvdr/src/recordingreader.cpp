@@ -0,0 +1,509 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <string.h>
+#include <algorithm>
+
+#include "xvdr/recordingreader.h"
+#include "xvdr/connection.h"
+#include "xvdr/msgpacket.h"
+#include "xvdr/command.h"
+
+using namespace XVDR;
+
+RecordingReader::RecordingReader(Connection* connection)
+ : m_connection(connection)
+ , m_position(0)
+ , m_length(0)
+ , m_frames(0)
+ , m_requested(0)
+ , m_update(0)
+ , m_growing(false)
+ , m_changed(false)
+ , m_open(false)
+ , m_window(InitialWindow)
+ , m_blocksize(InitialWindow / TargetDepth)
+ , m_depth(TargetDepth)
+ , m_ramp(MinBlockSize)
+ , m_ahead(InitialWindow)
+ , m_srtt(0)
+ , m_minrtt(0)
+ , m_rate(0)
+ , m_ratebytes(0)
+ , m_reads(0)
+{
+  memset(&m_stats, 0, sizeof(m_stats));
+  m_cache.SetSize(CacheSize);
+}
+
+RecordingReader::~RecordingReader()
+{
+  Close();
+}
+
+void RecordingReader::Open(const std::string& recid, uint32_t frames, uint64_t length)
+{
+  Close();
+
+  m_recid = recid;
+  m_frames = frames;
+  m_length = length;
+  m_growing = false;
+  m_changed = false;
+  m_lastupdate.Set(0);
+  m_open = true;
+
+  m_window = InitialWindow;
+  m_blocksize = InitialWindow / TargetDepth;
+  m_depth = TargetDepth;
+  m_srtt = 0;
+  m_minrtt = 0;
+  m_rate = 0;
+  m_ratebytes = 0;
+  m_ratetimer.Set(0);
+  memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void RecordingReader::Close()
+{
+  Reset();
+
+  if(m_update != 0)
+  {
+    m_connection->CancelRequest(m_update);
+    m_update = 0;
+  }
+
+  m_position = 0;
+  m_requested = 0;
+  m_length = 0;
+  m_frames = 0;
+  m_open = false;
+}
+
+void RecordingReader::Reset()
+{
+  while(!m_blocks.empty())
+    DropBlock();
+
+  // chunk aligned, so the received blocks can be cached
+  m_requested = m_position - m_position % BlockCache::ChunkSize;
+  m_ramp = MinBlockSize;
+  m_ahead = std::min((uint32_t)InitialWindow, m_window);
+}
+
+void RecordingReader::DropBlock()
+{
+  Block& b = m_blocks.front();
+
+  if(b.data == NULL)
+    m_connection->CancelRequest(b.handle);
+
+  delete b.data;
+  m_blocks.pop_front();
+}
+
+uint32_t RecordingReader::UpdateInterval()
+{
+  if(m_position + m_window < m_length)
+    return m_growing ? GrowingInterval : FinishedInterval;
+
+  // close to the known end, a running recording is updated on every read
+  return m_growing ? 0 : GrowingInterval;
+}
+
+void RecordingReader::UpdateLength(bool wait)
+{
+  if(m_update == 0)
+  {
+    bool changed = __atomic_exchange_n(&m_changed, false, __ATOMIC_ACQ_REL);
+
+    if(!changed && m_lastupdate.Elapsed() < UpdateInterval())
+      return;
+
+    MsgPacket vrp(XVDR_RECSTREAM_UPDATE);
+    m_update = m_connection->SendRequest(&vrp);
+    m_lastupdate.Set(0);
+
+    if(m_update == 0)
+      return;
+  }
+
+  if(!wait && !m_connection->ResponseReady(m_update))
+    return;
+
+  MsgPacket* vresp = m_connection->WaitResponse(m_update);
+  m_update = 0;
+
+  if(vresp == NULL)
+    return;
+
+  m_frames = vresp->get_U32();
+  uint64_t length = vresp->get_U64();
+
+  if(length != m_length)
+  {
+    m_growing = (length > m_length);
+    m_length = length;
+  }
+
+  delete vresp;
+}
+
+void RecordingReader::Fill()
+{
+  while(m_blocks.size() < m_depth && m_requested < m_length && m_requested < m_position + m_ahead)
+  {
+    if(FillCached())
+      continue;
+
+    // start with small blocks after a seek, the first one arrives earlier
+    uint32_t size = std::min(m_ramp, m_blocksize);
+    m_ramp = std::min(m_ramp * 2, (uint32_t)MaxBlockSize);
+
+    // don't request chunks we already have
+    uint32_t next = BlockCache::ChunkSize - (uint32_t)(m_requested % BlockCache::ChunkSize);
+
+    for(; next < size; next += BlockCache::ChunkSize)
+    {
+      if(m_cache.Contains(m_recid, m_requested + next))
+      {
+        size = next;
+        break;
+      }
+    }
+
+    MsgPacket vrp(XVDR_RECSTREAM_GETBLOCK);
+    vrp.put_U64(m_requested);
+    vrp.put_U32(size);
+
+    Block b;
+    b.offset = m_requested;
+    b.size = size;
+    b.data = NULL;
+    b.read = m_reads;
+    b.sent.Set(0);
+    b.handle = m_connection->SendRequest(&vrp);
+
+    if(b.handle == 0)
+      return;
+
+    m_blocks.push_back(b);
+    m_requested += size;
+  }
+}
+
+bool RecordingReader::FillCached()
+{
+  if(m_requested % BlockCache::ChunkSize != 0 || m_requested + BlockCache::ChunkSize > m_length)
+    return false;
+
+  if(!m_cache.Contains(m_recid, m_requested))
+    return false;
+
+  MsgPacket* p = new MsgPacket(XVDR_RECSTREAM_GETBLOCK, XVDR_CHANNEL_REQUEST_RESPONSE);
+  uint8_t* data = p->reserve(BlockCache::ChunkSize);
+
+  if(data == NULL || !m_cache.Get(m_recid, m_requested, data))
+  {
+    delete p;
+    return false;
+  }
+
+  Block b;
+  b.offset = m_requested;
+  b.size = BlockCache::ChunkSize;
+  b.handle = 0;
+  b.data = p;
+  b.read = m_reads;
+
+  m_blocks.push_back(b);
+  m_requested += BlockCache::ChunkSize;
+  m_stats.cached += BlockCache::ChunkSize;
+
+  return true;
+}
+
+void RecordingReader::Cache(Block& b)
+{
+  uint32_t length = b.data->getPayloadLength();
+  uint8_t* data = b.data->getPayload();
+
+  // full chunks only, the last one of a running recording is still growing
+  uint32_t offset = (BlockCache::ChunkSize - (uint32_t)(b.offset % BlockCache::ChunkSize)) % BlockCache::ChunkSize;
+
+  for(; offset + BlockCache::ChunkSize <= length; offset += BlockCache::ChunkSize)
+    m_cache.Put(m_recid, b.offset + offset, data + offset);
+}
+
+bool RecordingReader::Receive(Block& b)
+{
+  // the block was requested by a previous read, but still isn't here
+  bool stalled = (b.read != m_reads && !m_connection->ResponseReady(b.handle));
+
+  b.data = m_connection->WaitResponse(b.handle);
+
+  if(b.data == NULL)
+    return false;
+
+  uint32_t rtt = (uint32_t)b.sent.Elapsed();
+  uint32_t length = b.data->getPayloadLength();
+
+  m_stats.bytes += length;
+  m_stats.blocks++;
+
+  if(stalled)
+    m_stats.stalls++;
+
+  // throughput
+  m_ratebytes += length;
+  uint64_t elapsed = m_ratetimer.Elapsed();
+
+  if(elapsed >= RateInterval)
+  {
+    double rate = (double)m_ratebytes * 1000.0 / (double)elapsed;
+    m_rate = (m_rate == 0) ? rate : (m_rate * 3 + rate) / 4;
+    m_ratebytes = 0;
+    m_ratetimer.Set(0);
+  }
+
+  Adapt(rtt, stalled);
+  Cache(b);
+
+  // playback continues, read further ahead
+  m_ahead = std::min(m_ahead + length, m_window);
+
+  return true;
+}
+
+void RecordingReader::Adapt(uint32_t rtt, bool stalled)
+{
+  // millisecond resolution, loopback connections are treated as 1 ms
+  if(rtt == 0)
+    rtt = 1;
+
+  if(m_minrtt == 0 || rtt <= m_minrtt || m_minrtttimer.Elapsed() >= MinRttInterval)
+  {
+    m_minrtt = rtt;
+    m_minrtttimer.Set(0);
+  }
+
+  m_srtt = (m_srtt == 0) ? rtt : (m_srtt * 7 + rtt) / 8;
+
+  uint64_t bdp = (uint64_t)(m_rate * m_minrtt / 1000.0);
+
+  // a few milliseconds of jitter don't count as queueing on fast links
+  bool queueing = (m_srtt > m_minrtt * 2 && m_srtt > m_minrtt + QueueDelay);
+
+  // the reader waits, but the round trip time isn't inflated by queueing:
+  // the link is underused, double the data in flight
+  if(stalled && (m_srtt < m_minrtt * 3 / 2 || m_srtt < m_minrtt + QueueDelay))
+  {
+    m_window = std::min((uint64_t)m_window * 2, (uint64_t)MaxWindow);
+  }
+  // requests are queueing up, shrink towards the bandwidth delay product
+  else if(queueing)
+  {
+    uint64_t window = std::max((uint64_t)m_window * 3 / 4, bdp * 2);
+    m_window = std::min(std::max(window, (uint64_t)MinWindow), (uint64_t)MaxWindow);
+  }
+
+  // split the window into blocks
+  uint32_t blocksize = m_window / TargetDepth;
+  blocksize -= blocksize % MinBlockSize;
+
+  m_blocksize = std::min(std::max(blocksize, (uint32_t)MinBlockSize), (uint32_t)MaxBlockSize);
+  m_depth = std::min(std::max(m_window / m_blocksize, (uint32_t)MinDepth), (uint32_t)MaxDepth);
+}
+
+int RecordingReader::Read(uint8_t* buffer, uint32_t size)
+{
+  if(!m_open)
+    return -1;
+
+  UpdateLength(false);
+
+  // make sure the recording didn't grow before reporting the end
+  if(m_position >= m_length)
+  {
+    UpdateLength(true);
+
+    if(m_position >= m_length)
+      return 0;
+  }
+
+  uint32_t copied = 0;
+  bool retried = false;
+  m_reads++;
+
+  while(copied < size && m_position < m_length)
+  {
+    Fill();
+
+    if(m_blocks.empty())
+      break;
+
+    Block& b = m_blocks.front();
+
+    // return what we have instead of waiting for the next block
+    if(b.data == NULL && copied > 0 && !m_connection->ResponseReady(b.handle))
+      break;
+
+    if(b.data == NULL)
+    {
+      if(!Receive(b))
+      {
+        m_blocks.pop_front();
+        Reset();
+        break;
+      }
+
+      uint32_t length = b.data->getPayloadLength();
+
+      // short block, the blocks requested behind it don't fit anymore
+      if(length < b.size)
+      {
+        while(m_blocks.size() > 1)
+        {
+          Block last = m_blocks.back();
+
+          if(last.data == NULL)
+            m_connection->CancelRequest(last.handle);
+
+          delete last.data;
+          m_blocks.pop_back();
+        }
+
+        m_requested = b.offset + length;
+
+        if(length == 0)
+        {
+          DropBlock();
+          break;
+        }
+      }
+    }
+
+    uint32_t length = b.data->getPayloadLength();
+
+    // the reply ends in front of the position (short block at a segment
+    // boundary kept by a seek), request again starting at the position
+    if(m_position < b.offset || m_position - b.offset >= length)
+    {
+      while(!m_blocks.empty())
+        DropBlock();
+
+      // still short, the recording may have shrunk
+      if(retried)
+      {
+        __atomic_store_n(&m_changed, true, __ATOMIC_RELEASE);
+        break;
+      }
+
+      retried = true;
+      m_requested = m_position;
+      continue;
+    }
+
+    uint32_t offset = (uint32_t)(m_position - b.offset);
+    uint32_t count = length - offset;
+
+    if(count > size - copied)
+      count = size - copied;
+
+    memcpy(buffer + copied, b.data->getPayload() + offset, count);
+
+    copied += count;
+    m_position += count;
+
+    if(m_position >= b.offset + length)
+      DropBlock();
+  }
+
+  // keep the pipeline filled while the player processes the data
+  Fill();
+
+  if(copied == 0)
+    return (m_position >= m_length) ? 0 : -1;
+
+  return copied;
+}
+
+void RecordingReader::Seek(uint64_t position)
+{
+  m_position = position;
+
+  // new position isn't covered by the requested range
+  if(m_blocks.empty() || position < m_blocks.front().offset || position >= m_requested)
+  {
+    Reset();
+    return;
+  }
+
+  // drop the blocks in front of the new position
+  // (a short block is always the last one, m_requested ends with it)
+  while(position >= m_blocks.front().offset + m_blocks.front().size)
+    DropBlock();
+}
+
+uint64_t RecordingReader::GetPosition()
+{
+  return m_position;
+}
+
+uint64_t RecordingReader::GetLength()
+{
+  return m_length;
+}
+
+uint32_t RecordingReader::GetFrames()
+{
+  return m_frames;
+}
+
+void RecordingReader::GetStatistics(Statistics& s)
+{
+  s = m_stats;
+  s.rtt = m_srtt;
+  s.minrtt = m_minrtt;
+  s.rate = m_rate / (1024.0 * 1024.0);
+  s.blocksize = m_blocksize;
+  s.depth = m_depth;
+}
+
+void RecordingReader::RecordingsChanged()
+{
+  __atomic_store_n(&m_changed, true, __ATOMIC_RELEASE);
+  m_cache.Invalidate();
+}
+
+bool RecordingReader::SetCacheSize(size_t memory, size_t disk, const std::string& file)
+{
+  return m_cache.SetSize(memory, disk, file);
+}
+
+void RecordingReader::GetCacheStatistics(BlockCache::Statistics& s)
+{
+  m_cache.GetStatistics(s);
+}
@@ -38,6 +38,7 @@
 #include <sys/stat.h>
 
 #include "os-config.h"
+#include "packetreader.h"
 
 using namespace XVDR;
 
@@ -45,18 +46,50 @@ Session::Session()
   : m_timeout(3000)
   , m_fd(INVALID_SOCKET)
   , m_connectionLost(false)
+  , m_codec(MsgPacket::CODEC_ZLIB)
+  , m_reader(new PacketReader)
 {
   m_port = 34891;
+
+  // self-pipe to interrupt a waiting reader
+  m_wakeup[0] = INVALID_SOCKET;
+  m_wakeup[1] = INVALID_SOCKET;
+
+#ifndef WIN32
+  if(pipe(m_wakeup) == 0)
+  {
+    setsock_nonblock(m_wakeup[0]);
+    setsock_nonblock(m_wakeup[1]);
+    m_reader->setWakeup(m_wakeup[0]);
+  }
+#endif
 }
 
 Session::~Session()
 {
   Close();
+  delete m_reader;
+
+#ifndef WIN32
+  if(m_wakeup[0] != INVALID_SOCKET)
+  {
+    close(m_wakeup[0]);
+    close(m_wakeup[1]);
+  }
+#endif
 }
 
 void Session::Abort()
 {
   shutdown(m_fd, SHUT_RDWR);
+
+#ifndef WIN32
+  if(m_wakeup[1] != INVALID_SOCKET)
+  {
+    char c = 0;
+    if(write(m_wakeup[1], &c, 1) < 0) {} // pipe full, wakeup is pending anyway
+  }
+#endif
 }
 
 void Session::Close()
@@ -154,6 +187,15 @@ bool Session::Open(const std::string& hostname)
   if (m_fd == INVALID_SOCKET)
     return false;
 
+  m_reader->reset();
+  m_codec = MsgPacket::CODEC_ZLIB;
+
+#ifndef WIN32
+  // discard wakeups of a previous abort
+  char buffer[16];
+  while(m_wakeup[0] != INVALID_SOCKET && read(m_wakeup[0], buffer, sizeof(buffer)) > 0);
+#endif
+
   // store connection data
   m_hostname = hostname;
 
@@ -168,7 +210,7 @@ bool Session::IsOpen()
 MsgPacket* Session::ReadMessage()
 {
   bool bClosed = false;
-  MsgPacket* p = MsgPacket::read(m_fd, bClosed, m_timeout);
+  MsgPacket* p = m_reader->read(m_fd, bClosed, m_timeout, this);
 
   if(bClosed)
     SignalConnectionLost();
@@ -178,20 +220,66 @@ MsgPacket* Session::ReadMessage()
 
 bool Session::TransmitMessage(MsgPacket* vrp)
 {
+  MutexLock lock(&m_writelock);
   return vrp->write(m_fd, m_timeout);
 }
 
+bool Session::TransmitMessage(MsgPacket* vrp, int count)
+{
+  if(count <= 1)
+    return (count < 1) || TransmitMessage(vrp);
+
+  vrp->freeze();
+
+  uint32_t length = vrp->getPacketLength();
+  uint8_t* buffer = (uint8_t*)malloc(length * count);
+
+  if(buffer == NULL)
+    return false;
+
+  for(int i = 0; i < count; i++)
+    memcpy(buffer + i * length, vrp->getPacket(), length);
+
+  bool rc;
+
+  {
+    MutexLock lock(&m_writelock);
+    rc = writeData(buffer, length * count);
+  }
+
+  free(buffer);
+  return rc;
+}
+
 MsgPacket* Session::ReadResult(MsgPacket* vrp)
 {
   if(!TransmitMessage(vrp))
     return NULL;
 
-  return ReadMessage();
+  MsgPacket* vresp = ReadMessage();
+
+  if(vresp != NULL && vresp->isCompressed() && !vresp->uncompress((MsgPacket::Codec)m_codec))
+  {
+    delete vresp;
+    return NULL;
+  }
+
+  return vresp;
 }
 
 void Session::OnReconnect() {
 }
 
+uint32_t Session::GetPayloadPrefix(MsgPacket* /*p*/)
+{
+  return 0;
+}
+
+uint8_t* Session::GetPayloadBuffer(MsgPacket* /*p*/, uint32_t /*length*/)
+{
+  return NULL;
+}
+
 void Session::OnDisconnect() {
 }
 
@@ -206,6 +294,31 @@ void Session::SignalConnectionLost()
   OnDisconnect();
 }
 
+bool Session::writeData(const uint8_t* buffer, int totalBytes)
+{
+	int written = 0;
+
+	while(written < totalBytes) {
+		if(pollfd(m_fd, m_timeout, false) == 0) {
+			return false;
+		}
+
+		int rc = send(m_fd, (sendval_t*)(buffer + written), totalBytes - written, MSG_DONTWAIT);
+
+		if(rc == -1 || rc == 0) {
+			if(sockerror() == SEWOULDBLOCK) {
+				continue;
+			}
+
+			return false;
+		}
+
+		written += rc;
+	}
+
+	return true;
+}
+
 bool Session::readData(uint8_t* buffer, int totalBytes)
 {
 	int read = 0;
@@ -0,0 +1,219 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "xvdr/command.h"
+#include "xvdr/msgpacket.h"
+
+static const char* words[] = {
+	"the", "news", "weather", "report", "with", "and", "from", "in", "on", "a", "of", "to", "for",
+	"Tatort", "Nachrichten", "Wetter", "Sport", "Kommissar", "Mord", "Berlin", "Hamburg", "Film",
+	"documentary", "series", "episode", "season", "live", "football", "league", "match", "highlights",
+	"Spielfilm", "Deutschland", "Magazin", "Folge", "Staffel", "Krimi", "Komödie", "Drama", "Serie",
+	"investigates", "murder", "family", "secret", "journey", "world", "history", "nature", "science",
+	"USA", "2012", "HD", "Untertitel", "Wiederholung", "Dolby", "16:9", "Stereo", "(1/2)", "(2/2)",
+	"presenter", "guests", "talk", "show", "music", "concert", "orchestra", "classical", "rock", "jazz"
+};
+
+static std::string sentence(int count) {
+	std::string s;
+
+	for(int i = 0; i < count; i++) {
+		if(i > 0) {
+			s += " ";
+		}
+
+		s += words[rand() % (sizeof(words) / sizeof(words[0]))];
+	}
+
+	return s;
+}
+
+// EPG response payload as sent by the server (see EpgItem)
+static void createepg(MsgPacket& p, int events) {
+	uint32_t start = 1356994800;
+
+	for(int i = 0; i < events; i++) {
+		uint32_t duration = (5 + rand() % 20) * 300;
+
+		p.put_U32(1000 + i);
+		p.put_U32(start);
+		p.put_U32(duration);
+		p.put_U32(rand() & 0xFF);
+		p.put_U32(rand() % 18);
+		p.put_String(sentence(1 + rand() % 4).c_str());
+		p.put_String(sentence(rand() % 8).c_str());
+		p.put_String(sentence(20 + rand() % 80).c_str());
+
+		start += duration;
+	}
+}
+
+static bool loadfile(MsgPacket& p, const char* filename) {
+	FILE* f = fopen(filename, "rb");
+
+	if(f == NULL) {
+		return false;
+	}
+
+	uint8_t buffer[64 * 1024];
+	size_t rc = 0;
+
+	while((rc = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+		memcpy(p.reserve(rc), buffer, rc);
+	}
+
+	fclose(f);
+	return true;
+}
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+}
+
+static void benchmark(MsgPacket& source, MsgPacket::Codec codec, int level) {
+	uint32_t size = source.getPayloadLength();
+
+	// serialized uncompressed packet
+	std::string raw((const char*)source.getPacket(), source.getPacketLength());
+
+	double compresstime = 0;
+	double decompresstime = 0;
+	uint32_t compressedsize = 0;
+	int rounds = 0;
+
+	while(compresstime + decompresstime < 1.0) {
+		MsgPacket p;
+		std::istringstream in(raw);
+		MsgPacket::readstream(in, p);
+
+		double t = now();
+
+		if(!p.compress(level, codec)) {
+			printf("%-6s level %i: compression failed\n", MsgPacket::getCodecName(codec), level);
+			return;
+		}
+
+		compresstime += now() - t;
+		compressedsize = p.getPayloadLength();
+
+		t = now();
+
+		if(!p.uncompress(codec) || p.getPayloadLength() != size || memcmp(p.getPayload(), source.getPayload(), size) != 0) {
+			printf("%-6s level %i: decompression failed\n", MsgPacket::getCodecName(codec), level);
+			return;
+		}
+
+		decompresstime += now() - t;
+		rounds++;
+	}
+
+	double mb = (double)size * rounds / (1024.0 * 1024.0);
+
+	printf("%-6s level %i: ratio %5.2f  compress %8.1f MB/s  decompress %8.1f MB/s\n",
+		MsgPacket::getCodecName(codec), level,
+		(double)size / (double)compressedsize,
+		mb / compresstime,
+		mb / decompresstime);
+}
+
+// a compressed packet announcing an oversized payload must be rejected
+static bool rejectlength(MsgPacket& source, MsgPacket::Codec codec, uint32_t length) {
+	std::string raw((const char*)source.getPacket(), source.getPacketLength());
+
+	MsgPacket p;
+	std::istringstream in(raw);
+	MsgPacket::readstream(in, p);
+
+	if(!p.compress(6, codec)) {
+		return true;
+	}
+
+	std::vector<uint8_t> data(p.getPacket(), p.getPacket() + p.getPacketLength());
+	uint8_t* header = &data[MsgPacket::UncompressedPayloadLengthPos];
+	header[0] = (uint8_t)(length >> 24);
+	header[1] = (uint8_t)(length >> 16);
+	header[2] = (uint8_t)(length >> 8);
+	header[3] = (uint8_t)length;
+
+	MsgPacket* q = MsgPacket::attach(&data[0], data.size());
+	bool rejected = (q != NULL && !q->uncompress(codec));
+	delete q;
+
+	return rejected;
+}
+
+int main(int argc, char* argv[]) {
+	MsgPacket p(XVDR_EPG_GETFORCHANNEL, XVDR_CHANNEL_REQUEST_RESPONSE);
+
+	// captured payload or synthetic EPG data (one week, one channel)
+	if(argc >= 2) {
+		if(!loadfile(p, argv[1])) {
+			printf("unable to read %s\n", argv[1]);
+			return 1;
+		}
+	}
+	else {
+		srand(1);
+		createepg(p, 7 * 40);
+	}
+
+	p.freeze();
+	printf("payload: %u bytes\n\n", p.getPayloadLength());
+
+	static const int levels[] = { 1, 6, 9 };
+
+	for(int c = 0; c < MsgPacket::CODEC_COUNT; c++) {
+		MsgPacket::Codec codec = (MsgPacket::Codec)c;
+
+		if(!MsgPacket::isCodecSupported(codec)) {
+			printf("%-6s not supported\n", MsgPacket::getCodecName(codec));
+			continue;
+		}
+
+		// lz4 doesn't use the compression level
+		size_t count = (codec == MsgPacket::CODEC_LZ4) ? 1 : sizeof(levels) / sizeof(levels[0]);
+
+		for(size_t i = 0; i < count; i++) {
+			benchmark(p, codec, levels[i]);
+		}
+
+		if(!rejectlength(p, codec, 0xFFFFFFF0) || !rejectlength(p, codec, 64 * 1024 * 1024)) {
+			printf("%-6s oversized payload length accepted\n", MsgPacket::getCodecName(codec));
+			return 1;
+		}
+	}
+
+	return 0;
+}
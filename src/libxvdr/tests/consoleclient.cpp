@@ -78,7 +78,13 @@ void ConsoleClient::SetPacketData(XVDR::Packet* packet, uint8_t* data, int index
   p->duration = duration;
   p->index = index;
 
-  memcpy(p->data, data, p->length);
+  if(data != NULL) {
+    memcpy(p->data, data, p->length);
+  }
+}
+
+uint8_t* ConsoleClient::GetPacketBuffer(XVDR::Packet* packet) {
+  return ((Packet*)packet)->data;
 }
 
 void ConsoleClient::FreePacket(XVDR::Packet* packet) {
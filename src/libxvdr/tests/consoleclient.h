@@ -56,6 +56,8 @@ public:
   void SetPacketData(XVDR::Packet* packet, uint8_t* data, int index, uint64_t pts, uint64_t dts, uint32_t duration);
   void FreePacket(XVDR::Packet* packet);
 
+  uint8_t* GetPacketBuffer(XVDR::Packet* packet);
+
   std::map<int, XVDR::Channel> m_channels;
 
   struct Packet {
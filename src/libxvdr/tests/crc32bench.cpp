@@ -0,0 +1,122 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "crc32.h"
+#include "xvdr/thread.h"
+
+using namespace XVDR;
+
+static bool verify(CRC32::Variant variant, const uint8_t* data, size_t size) {
+	// all lengths and alignments up to 4 x 64 byte blocks + tail
+	for(size_t offset = 0; offset < 16; offset++) {
+		for(size_t length = 0; length < 300 && offset + length <= size; length++) {
+			uint32_t reference = CRC32::compute(CRC32::BYTEWISE, data + offset, length);
+
+			if(CRC32::compute(variant, data + offset, length) != reference) {
+				printf("%s: mismatch at offset %lu length %lu\n", CRC32::name(variant), (unsigned long)offset, (unsigned long)length);
+				return false;
+			}
+		}
+	}
+
+	// large block, incremental update
+	uint32_t reference = CRC32::compute(CRC32::BYTEWISE, data, size);
+
+	if(CRC32::compute(variant, data, size) != reference) {
+		printf("%s: mismatch on %lu bytes\n", CRC32::name(variant), (unsigned long)size);
+		return false;
+	}
+
+	if(CRC32::update(CRC32::update(0, data, 1000), data + 1000, size - 1000) != reference) {
+		printf("incremental update mismatch\n");
+		return false;
+	}
+
+	return true;
+}
+
+static double benchmark(CRC32::Variant variant, const uint8_t* data, size_t size) {
+	uint64_t bytes = 0;
+	uint32_t crc = 0;
+	uint64_t start = TimeMs::Now();
+	uint64_t elapsed = 0;
+
+	while((elapsed = TimeMs::Now() - start) < 500) {
+		for(int i = 0; i < 16; i++) {
+			crc ^= CRC32::compute(variant, data, size);
+			bytes += size;
+		}
+	}
+
+	// prevent the compiler from dropping the loop
+	if(crc == 0x12345678) {
+		printf(" ");
+	}
+
+	return (double)bytes / ((double)elapsed / 1000.0) / (1024.0 * 1024.0 * 1024.0);
+}
+
+int main() {
+	static const size_t sizes[] = { 28, 1024, 16 * 1024, 1024 * 1024 };
+	size_t maxsize = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+
+	uint8_t* data = (uint8_t*)malloc(maxsize);
+
+	srand(1);
+	for(size_t i = 0; i < maxsize; i++) {
+		data[i] = rand() & 0xFF;
+	}
+
+	printf("selected implementation: %s\n\n", CRC32::name(CRC32::selected()));
+
+	int rc = 0;
+
+	for(int v = 0; v < CRC32::VARIANT_COUNT; v++) {
+		CRC32::Variant variant = (CRC32::Variant)v;
+
+		if(!CRC32::supported(variant)) {
+			printf("%-14s not supported\n", CRC32::name(variant));
+			continue;
+		}
+
+		if(!verify(variant, data, maxsize)) {
+			rc = 1;
+			continue;
+		}
+
+		printf("%-14s", CRC32::name(variant));
+
+		for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+			printf("  %7lu bytes: %6.2f GB/s", (unsigned long)sizes[i], benchmark(variant, data, sizes[i]));
+		}
+
+		printf("\n");
+	}
+
+	free(data);
+	return rc;
+}
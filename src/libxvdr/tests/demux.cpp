@@ -27,6 +27,7 @@
 #include "consoleclient.h"
 #include "xvdr/demux.h"
 #include "xvdr/connection.h"
+#include "xvdr/msgpacketpool.h"
 
 using namespace XVDR;
 
@@ -76,34 +77,43 @@ int main(int argc, char* argv[]) {
 
   client.Log(INFO, "Switched to channel after %i ms", switchTime);
 
+  Packet* packets[16];
+
   for(int i = 0; i < 100;) {
-    p = demux.Read<ConsoleClient::Packet>();
+    int count = demux.ReadMany(packets, 16, 1000);
 
-    if(p == NULL) {
-      client.Log(INFO, "end of stream ...");
-      break;
-    }
+    if(count == 0) {
+      if(demux.ConnectionLost() || demux.Aborting()) {
+        client.Log(INFO, "end of stream ...");
+        break;
+      }
 
-    if(p->data == NULL) {
-      //client.Log(INFO, "Wait ...");
+      continue;
     }
-    else {
-      if(firstPacket == 0) {
-        firstPacket = t.Elapsed();
-        client.Log(INFO, "Received first packet after %i ms", firstPacket);
-      }
-      if(firstVideoPacket == 0 && p->index == 0) {
-        firstVideoPacket = t.Elapsed();
-        client.Log(INFO, "Received first video packet after %i ms", firstVideoPacket);
+
+    for(int k = 0; k < count; k++) {
+      p = (ConsoleClient::Packet*)packets[k];
+
+      if(p->data != NULL) {
+        if(firstPacket == 0) {
+          firstPacket = t.Elapsed();
+          client.Log(INFO, "Received first packet after %i ms", firstPacket);
+        }
+        if(firstVideoPacket == 0 && p->index == 0) {
+          firstVideoPacket = t.Elapsed();
+          client.Log(INFO, "Received first video packet after %i ms", firstVideoPacket);
+        }
+        uint32_t header = p->data[0] << 24 | p->data[1] << 16 | p->data[2] << 8 | p->data[3];
+        client.Log(INFO, "Demux (index: %i length: %i bytes) Header: %08X PTS: %lli", p->index, p->length, header, p->pts);
+        i++;
       }
-      uint32_t header = p->data[0] << 24 | p->data[1] << 16 | p->data[2] << 8 | p->data[3];
-      client.Log(INFO, "Demux (index: %i length: %i bytes) Header: %08X PTS: %lli", p->index, p->length, header, p->pts);
-      i++;
-    }
 
-    client.FreePacket(p);
+      client.FreePacket(p);
+    }
   }
 
+  QueueStatus queue = demux.GetQueueStatus();
+
   client.Log(INFO, "Stopping ...");
   t.Set(0);
 
@@ -119,5 +129,13 @@ int main(int argc, char* argv[]) {
   client.Log(INFO, "First packet after: %i ms", firstPacket);
   client.Log(INFO, "First video after: %i ms", firstVideoPacket);
 
+  client.Log(INFO, "Server queue: %u%% full (%u reports, backlog %s)", queue.ServerFill, queue.Reports, queue.Backlog ? "on" : "off");
+  client.Log(INFO, "Local queue: %llu / %llu bytes (%u packets dropped)", (unsigned long long)queue.LocalQueued, (unsigned long long)queue.LocalCapacity, queue.Dropped);
+
+  MsgPacketPool::Statistics stats;
+  MsgPacketPool::getStatistics(stats);
+
+  client.Log(INFO, "Packet pool: %llu hits / %llu misses (%llu bytes cached)", (unsigned long long)stats.hits, (unsigned long long)stats.misses, (unsigned long long)stats.cached);
+
   return 0;
 }
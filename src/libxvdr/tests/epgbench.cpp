@@ -0,0 +1,322 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+/*
+ * Measures the EPG update of all channels against a minimal EPG server
+ * running on the local host, answering every request after a fixed latency.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include "consoleclient.h"
+#include "xvdr/command.h"
+#include "xvdr/msgpacket.h"
+#include "os-config.h"
+
+using namespace XVDR;
+
+static const int eventcount = 20;
+
+class EpgServer : public Thread {
+public:
+
+  EpgServer(int channels, int latency) : m_fd(INVALID_SOCKET), m_client(INVALID_SOCKET), m_channels(channels), m_latency(latency), m_requests(0) {
+  }
+
+  ~EpgServer() {
+    Cancel(1);
+
+    while(!m_pending.empty()) {
+      delete m_pending.front().packet;
+      m_pending.pop_front();
+    }
+
+    if(m_fd != INVALID_SOCKET) {
+      closesocket(m_fd);
+    }
+  }
+
+  bool Listen() {
+    m_fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    int one = 1;
+    setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, (sockval_t)&one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(34891);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if(bind(m_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(m_fd, 1) != 0) {
+      return false;
+    }
+
+    return Start();
+  }
+
+  int GetRequests() {
+    MutexLock lock(&m_lock);
+    return m_requests;
+  }
+
+  void ResetRequests() {
+    MutexLock lock(&m_lock);
+    m_requests = 0;
+  }
+
+protected:
+
+  // response waiting for the latency to expire
+  struct Response {
+    MsgPacket* packet;
+    TimeMs due;
+  };
+
+  void Action() {
+    while(Running() && !pollfd(m_fd, 100, true));
+
+    m_client = accept(m_fd, NULL, NULL);
+
+    while(Running()) {
+      bool closed = false;
+      MsgPacket* request = MsgPacket::read(m_client, closed, 1);
+
+      if(closed) {
+        break;
+      }
+
+      if(request != NULL) {
+        Response r;
+        r.packet = Process(request);
+        r.due.Set(m_latency);
+        m_pending.push_back(r);
+
+        delete request;
+      }
+
+      // the latency is the same for all responses, they are due in order
+      while(!m_pending.empty() && m_pending.front().due.TimedOut()) {
+        m_pending.front().packet->write(m_client);
+        delete m_pending.front().packet;
+        m_pending.pop_front();
+      }
+    }
+
+    closesocket(m_client);
+  }
+
+  MsgPacket* Process(MsgPacket* request) {
+    uint16_t msgid = request->getMsgID();
+    MsgPacket* response = new MsgPacket(msgid, XVDR_CHANNEL_REQUEST_RESPONSE, request->getUID());
+
+    switch(msgid) {
+      case XVDR_LOGIN:
+        response->put_U32(0);
+        response->put_S32(0);
+        response->put_String("epgbench");
+        response->put_String("1.0");
+        break;
+
+      case XVDR_CHANNELS_GETCHANNELS:
+        // tv channels only
+        if(request->get_U32() != 0) {
+          break;
+        }
+
+        for(int i = 1; i <= m_channels; i++) {
+          response->put_U32(i);
+          response->put_String("channel");
+          response->put_U32(1000 + i);
+          response->put_U32(0);
+          response->put_String("");
+          response->put_String("");
+        }
+        break;
+
+      case XVDR_EPG_GETFORCHANNEL: {
+        uint32_t channeluid = request->get_U32();
+        uint32_t start = request->get_U32();
+
+        {
+          MutexLock lock(&m_lock);
+          m_requests++;
+        }
+
+        // the broadcast id tells the channel the event belongs to
+        for(int i = 0; i < eventcount; i++) {
+          response->put_U32(channeluid * 100 + i);
+          response->put_U32(start + i * 3600);
+          response->put_U32(3600);
+          response->put_U32(0);
+          response->put_U32(0);
+          response->put_String("title");
+          response->put_String("outline");
+          response->put_String("plot");
+        }
+        break;
+      }
+
+      default:
+        response->put_U32(XVDR_RET_OK);
+        break;
+    }
+
+    return response;
+  }
+
+private:
+
+  int m_fd;
+
+  int m_client;
+
+  int m_channels;
+
+  int m_latency;
+
+  int m_requests;
+
+  std::deque<Response> m_pending;
+
+  Mutex m_lock;
+};
+
+class EpgClient : public ConsoleClient {
+public:
+
+  EpgClient() : m_events(0), m_mismatches(0) {}
+
+  void TransferEpgEntry(const XVDR::EpgItem& item) {
+    m_events++;
+
+    if(item.BroadcastID / 100 != item.UID) {
+      m_mismatches++;
+    }
+  }
+
+  void Reset() {
+    m_events = 0;
+    m_mismatches = 0;
+  }
+
+  int m_events;
+
+  int m_mismatches;
+};
+
+static bool Check(EpgClient& client, EpgServer& server, const char* name, uint64_t elapsed, int channels) {
+  bool rc = (client.m_events == channels * eventcount && client.m_mismatches == 0);
+
+  client.Log(rc ? INFO : FAILURE, "%-10s %i channels in %llu ms, %i requests, %i events (%i on the wrong channel)", name, channels,
+    (unsigned long long)elapsed, server.GetRequests(), client.m_events, client.m_mismatches);
+
+  client.Reset();
+  server.ResetRequests();
+
+  return rc;
+}
+
+int main(int argc, char* argv[]) {
+  int latency = (argc >= 2) ? atoi(argv[1]) : 50;
+  int channels = (argc >= 3) ? atoi(argv[2]) : 100;
+
+  EpgServer server(channels, latency);
+  EpgClient client;
+  bool rc = true;
+
+  if(!server.Listen()) {
+    client.Log(FAILURE, "Unable to listen on port 34891 !");
+    return 1;
+  }
+
+  if(!client.Open("127.0.0.1", "EPG benchmark")) {
+    client.Log(FAILURE, "Unable to connect !");
+    return 1;
+  }
+
+  client.Log(INFO, "EPG update of %i channels, %i ms latency", channels, latency);
+
+  time_t start = time(NULL);
+  time_t end = start + 7 * 24 * 3600;
+  TimeMs t;
+
+  // one request per channel, without channel list nothing is prefetched
+  client.Reset();
+  server.ResetRequests();
+  t.Set(0);
+
+  for(int i = 1; i <= channels; i++) {
+    client.GetEPGForChannel(1000 + i, start, end);
+  }
+
+  rc = Check(client, server, "serial", t.Elapsed(), channels) && rc;
+
+  // channel by channel in the order of the channel list, as done by XBMC
+  client.GetChannelsList(false);
+  client.GetChannelsList(true);
+  server.ResetRequests();
+  t.Set(0);
+
+  for(int i = 1; i <= channels; i++) {
+    client.GetEPGForChannel(1000 + i, start, end);
+  }
+
+  rc = Check(client, server, "prefetched", t.Elapsed(), channels) && rc;
+
+  // in reverse order prefetching stops after the first miss
+  t.Set(0);
+
+  for(int i = channels; i >= 1; i--) {
+    client.GetEPGForChannel(1000 + i, start, end);
+  }
+
+  // the requests prefetched by the last call of the previous pass are the only extra ones
+  int requests = server.GetRequests();
+  rc = Check(client, server, "reverse", t.Elapsed(), channels) && rc;
+
+  if(requests > channels + 8) {
+    client.Log(FAILURE, "%i requests in reverse order, prefetching didn't stop", requests);
+    rc = false;
+  }
+
+  // all channels at once
+  std::vector<uint32_t> channeluids;
+
+  for(int i = 1; i <= channels; i++) {
+    channeluids.push_back(1000 + i);
+  }
+
+  t.Set(0);
+  client.GetEPGForChannels(channeluids, start, end);
+
+  rc = Check(client, server, "batch", t.Elapsed(), channels) && rc;
+
+  client.Close();
+
+  return rc ? 0 : 1;
+}
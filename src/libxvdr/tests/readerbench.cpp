@@ -0,0 +1,197 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "os-config.h"
+#include "packetreader.h"
+#include "xvdr/command.h"
+#include "xvdr/msgpacket.h"
+#include "xvdr/thread.h"
+
+using namespace XVDR;
+
+// stream of serialized packets written by the sender thread
+class Sender : public Thread {
+public:
+
+	Sender(int fd, const std::vector<uint8_t>& stream, int rounds) : m_fd(fd), m_stream(stream), m_rounds(rounds) {
+	}
+
+protected:
+
+	void Action() {
+		for(int i = 0; i < m_rounds; i++) {
+			size_t written = 0;
+
+			while(written < m_stream.size()) {
+				int rc = ::write(m_fd, &m_stream[written], m_stream.size() - written);
+
+				if(rc <= 0) {
+					return;
+				}
+
+				written += rc;
+			}
+		}
+	}
+
+private:
+
+	int m_fd;
+	const std::vector<uint8_t>& m_stream;
+	int m_rounds;
+};
+
+static int createstream(std::vector<uint8_t>& stream) {
+	// typical live stream mix: video chunks, audio frames, occasional large responses
+	static const uint32_t sizes[] = { 1316, 1024, 256, 1316, 1024, 1316, 384, 1316 };
+	int count = 0;
+
+	for(int i = 0; i < 1000; i++) {
+		uint32_t size = (i == 500) ? 256 * 1024 : sizes[i % (sizeof(sizes) / sizeof(sizes[0]))];
+		MsgPacket p(XVDR_STREAM_MUXPKT, XVDR_CHANNEL_STREAM);
+
+		uint8_t* data = p.reserve(size);
+
+		for(uint32_t n = 0; n < size; n++) {
+			data[n] = (uint8_t)(n + i);
+		}
+
+		p.freeze();
+		stream.insert(stream.end(), p.getPacket(), p.getPacket() + p.getPacketLength());
+		count++;
+	}
+
+	return count;
+}
+
+static double run(bool buffered, const std::vector<uint8_t>& stream, int count, int rounds, PacketReader::Statistics& stats) {
+	int fds[2];
+
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+		return 0;
+	}
+
+	Sender sender(fds[1], stream, rounds);
+	PacketReader reader;
+	bool closed = false;
+	int received = 0;
+
+	uint64_t start = TimeMs::Now();
+	sender.Start();
+
+	for(int i = 0; i < count * rounds; i++) {
+		MsgPacket* p = buffered ? reader.read(fds[0], closed) : MsgPacket::read(fds[0], closed);
+
+		if(p == NULL) {
+			break;
+		}
+
+		received++;
+		delete p;
+	}
+
+	uint64_t elapsed = TimeMs::Now() - start;
+
+	close(fds[0]);
+	close(fds[1]);
+
+	reader.getStatistics(stats);
+
+	if(received != count * rounds) {
+		printf("received %i of %i packets\n", received, count * rounds);
+		return 0;
+	}
+
+	return (double)received / ((double)(elapsed ? elapsed : 1) / 1000.0);
+}
+
+static bool partial() {
+	int fds[2];
+
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+		return false;
+	}
+
+	// payload larger than the receive buffer, interrupted by a timeout
+	uint32_t size = 128 * 1024;
+	MsgPacket p(XVDR_STREAM_MUXPKT, XVDR_CHANNEL_STREAM);
+	uint8_t* data = p.reserve(size);
+
+	for(uint32_t n = 0; n < size; n++) {
+		data[n] = (uint8_t)n;
+	}
+
+	p.freeze();
+
+	PacketReader reader;
+	bool closed = false;
+	uint32_t half = p.getPacketLength() / 2;
+
+	bool rc = (::write(fds[1], p.getPacket(), half) == (int)half);
+	MsgPacket* r = reader.read(fds[0], closed, 10);
+
+	rc = rc && (r == NULL && !closed);
+
+	rc = rc && (::write(fds[1], p.getPacket() + half, p.getPacketLength() - half) == (int)(p.getPacketLength() - half));
+	r = reader.read(fds[0], closed, 1000);
+
+	rc = rc && (r != NULL && r->getPayloadLength() == size && memcmp(r->getPayload(), data, size) == 0);
+
+	delete r;
+	close(fds[0]);
+	close(fds[1]);
+
+	printf("partial payload   %s\n", rc ? "OK" : "FAILED");
+	return rc;
+}
+
+int main(int argc, char* argv[]) {
+	std::vector<uint8_t> stream;
+	int rounds = (argc >= 2) ? atoi(argv[1]) : 200;
+	int count = createstream(stream);
+
+	printf("%i packets (%lu bytes) x %i rounds\n\n", count, (unsigned long)stream.size(), rounds);
+
+	PacketReader::Statistics stats;
+
+	double legacy = run(false, stream, count, rounds, stats);
+	printf("MsgPacket::read   %10.0f packets/s\n", legacy);
+
+	double buffered = run(true, stream, count, rounds, stats);
+	printf("PacketReader      %10.0f packets/s  (%.3f recv + %.3f poll calls per packet)\n",
+		buffered,
+		(double)stats.recvcalls / (double)stats.packets,
+		(double)stats.pollcalls / (double)stats.packets);
+
+	bool resumed = partial();
+
+	return (legacy > 0 && buffered > 0 && resumed) ? 0 : 1;
+}
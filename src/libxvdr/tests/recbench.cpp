@@ -0,0 +1,218 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "consoleclient.h"
+
+using namespace XVDR;
+
+static const uint32_t readsize = 32 * 1024;
+
+static void PrintStatistics(ConsoleClient& client) {
+  RecordingReader::Statistics s;
+  client.GetRecordingStatistics(s);
+
+  client.Log(INFO, "reader: %.2f MB/s, rtt %u ms (min %u ms), %u blocks of %u kB in flight, %llu blocks received, %llu stalls",
+    s.rate, s.rtt, s.minrtt, s.depth, s.blocksize / 1024, (unsigned long long)s.blocks, (unsigned long long)s.stalls);
+
+  BlockCache::Statistics c;
+  client.GetRecordingCacheStatistics(c);
+
+  client.Log(INFO, "cache: %llu bytes read from the cache, %llu hits, %llu disk hits, %llu misses, %u chunks in memory, %u chunks on disk",
+    (unsigned long long)s.cached, (unsigned long long)c.hits, (unsigned long long)c.diskhits, (unsigned long long)c.misses, (unsigned int)c.memory, (unsigned int)c.disk);
+}
+
+// seeks to random positions, each followed by one second of playback (about 1MB)
+static void SeekBenchmark(ConsoleClient& client, const char* name, uint64_t length, int seeks) {
+  static uint8_t buffer[readsize];
+  uint64_t maxwait = 0;
+  uint64_t sum = 0;
+  TimeMs t;
+
+  srand(42);
+
+  for(int i = 0; i < seeks; i++) {
+    long long position = (long long)((double)rand() / RAND_MAX * (length - 1024 * 1024));
+    TimeMs r;
+
+    client.SeekRecording(position, SEEK_SET);
+
+    if(client.ReadRecording(buffer, readsize) <= 0) {
+      client.Log(FAILURE, "Read failed after seeking to %lli", position);
+      break;
+    }
+
+    if(r.Elapsed() > maxwait) {
+      maxwait = r.Elapsed();
+    }
+
+    sum += r.Elapsed();
+
+    for(int n = 1; n < 32; n++) {
+      client.ReadRecording(buffer, readsize);
+    }
+  }
+
+  uint64_t elapsed = t.Elapsed();
+
+  if(seeks > 0) {
+    client.Log(INFO, "%s: %i seeks in %llu ms, time to first data avg %llu ms, max %llu ms", name, seeks, (unsigned long long)elapsed,
+      (unsigned long long)(sum / seeks), (unsigned long long)maxwait);
+  }
+
+  PrintStatistics(client);
+}
+
+// seeks to random playback times through the keyframe map
+static void KeyFrameBenchmark(ConsoleClient& client, const char* name, int seeks) {
+  static uint8_t buffer[readsize];
+  uint32_t frames = client.RecordingFrames();
+  uint64_t maxwait = 0;
+  uint64_t sum = 0;
+  int failed = 0;
+
+  srand(42);
+
+  for(int i = 0; i < seeks; i++) {
+    uint32_t ms = (uint32_t)((double)rand() / RAND_MAX * frames * 40.0);
+    TimeMs r;
+
+    if(client.SeekRecordingTime(ms) < 0 || client.ReadRecording(buffer, readsize) <= 0) {
+      failed++;
+      continue;
+    }
+
+    if(r.Elapsed() > maxwait) {
+      maxwait = r.Elapsed();
+    }
+
+    sum += r.Elapsed();
+  }
+
+  RecordingIndex::Statistics s;
+  client.GetRecordingIndexStatistics(s);
+
+  if(seeks > failed) {
+    client.Log(INFO, "%s: %i seeks (%i failed), time to keyframe data avg %llu ms, max %llu ms, %llu lookups, %llu requests, %u keyframes",
+      name, seeks, failed, (unsigned long long)(sum / (seeks - failed)), (unsigned long long)maxwait,
+      (unsigned long long)s.lookups, (unsigned long long)s.requests, (unsigned int)s.keyframes);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  std::string hostname = "192.168.16.10";
+  std::string recid;
+  int megabytes = 64;
+  int seeks = 20;
+
+  if(argc < 3) {
+    printf("usage: %s <hostname> <recording id> [megabytes] [seeks] [cache file]\n", argv[0]);
+    return 1;
+  }
+
+  hostname = argv[1];
+  recid = argv[2];
+
+  if(argc >= 4) {
+    megabytes = atoi(argv[3]);
+  }
+  if(argc >= 5) {
+    seeks = atoi(argv[4]);
+  }
+
+  ConsoleClient client;
+
+  // small memory tier, chunks spill to the cache file
+  if(argc >= 6 && !client.SetRecordingCache(8 * 1024 * 1024, 512 * 1024 * 1024, argv[5])) {
+    client.Log(FAILURE, "Unable to create cache file !");
+    return 1;
+  }
+
+  if(!client.Open(hostname, "Recording benchmark client")) {
+    client.Log(FAILURE,"Unable to open connection !");
+    return 1;
+  }
+
+  if(!client.OpenRecording(recid)) {
+    client.Log(FAILURE, "Unable to open recording !");
+    return 1;
+  }
+
+  uint64_t length = client.RecordingLength();
+  uint64_t total = (uint64_t)megabytes * 1024 * 1024;
+
+  if(total > length) {
+    total = length;
+  }
+
+  client.Log(INFO, "Reading %llu of %llu bytes (%u bytes per read) ..", (unsigned long long)total, (unsigned long long)length, readsize);
+
+  static uint8_t buffer[readsize];
+  uint64_t bytes = 0;
+  uint64_t maxwait = 0;
+  int reads = 0;
+  TimeMs t;
+
+  // sequential playback
+  while(bytes < total) {
+    TimeMs r;
+    int rc = client.ReadRecording(buffer, readsize);
+
+    if(rc <= 0) {
+      client.Log(FAILURE, "Read failed at position %llu", (unsigned long long)client.RecordingPosition());
+      break;
+    }
+
+    if(r.Elapsed() > maxwait) {
+      maxwait = r.Elapsed();
+    }
+
+    bytes += rc;
+    reads++;
+  }
+
+  uint64_t elapsed = t.Elapsed();
+
+  client.Log(INFO, "sequential: %llu bytes in %llu ms (%.2f MB/s), %i reads, max wait %llu ms", (unsigned long long)bytes, (unsigned long long)elapsed,
+    elapsed ? (double)bytes / (1024.0 * 1024.0) / ((double)elapsed / 1000.0) : 0.0, reads, (unsigned long long)maxwait);
+
+  PrintStatistics(client);
+
+  // random seeks, then the same positions again (served by the cache)
+  SeekBenchmark(client, "seek", length, seeks);
+  SeekBenchmark(client, "revisit", length, seeks);
+
+  // the same playback times twice, the second run uses the keyframe map
+  if(client.RecordingFrames() > 0) {
+    KeyFrameBenchmark(client, "keyframe", seeks);
+    KeyFrameBenchmark(client, "cached", seeks);
+  }
+
+  client.CloseRecording();
+  client.Close();
+
+  return 0;
+}
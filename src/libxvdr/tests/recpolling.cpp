@@ -0,0 +1,305 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+/*
+ * Counts the requests needed to play a recording against a minimal
+ * recording server running on the local host.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "consoleclient.h"
+#include "xvdr/command.h"
+#include "xvdr/msgpacket.h"
+#include "os-config.h"
+
+using namespace XVDR;
+
+static const uint32_t readsize = 32 * 1024;
+
+static uint8_t pattern(uint64_t position) {
+  return (uint8_t)((position * 7) >> 3);
+}
+
+class RecordingServer : public Thread {
+public:
+
+  RecordingServer() : m_fd(INVALID_SOCKET), m_client(INVALID_SOCKET), m_length(0) {
+    memset(m_requests, 0, sizeof(m_requests));
+  }
+
+  ~RecordingServer() {
+    Cancel(1);
+
+    if(m_fd != INVALID_SOCKET) {
+      closesocket(m_fd);
+    }
+  }
+
+  bool Listen() {
+    m_fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    int one = 1;
+    setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, (sockval_t)&one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(34891);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if(bind(m_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(m_fd, 1) != 0) {
+      return false;
+    }
+
+    return Start();
+  }
+
+  void SetLength(uint64_t length) {
+    MutexLock lock(&m_lock);
+    m_length = length;
+  }
+
+  uint64_t GetLength() {
+    MutexLock lock(&m_lock);
+    return m_length;
+  }
+
+  int GetRequests(int msgid) {
+    MutexLock lock(&m_lock);
+    return m_requests[msgid];
+  }
+
+  void ResetRequests() {
+    MutexLock lock(&m_lock);
+    memset(m_requests, 0, sizeof(m_requests));
+  }
+
+  void RecordingsChanged() {
+    MsgPacket msg(XVDR_STATUS_RECORDINGSCHANGE, XVDR_CHANNEL_STATUS);
+    Send(&msg);
+  }
+
+protected:
+
+  void Send(MsgPacket* p) {
+    MutexLock lock(&m_lock);
+    p->write(m_client);
+  }
+
+  void Action() {
+    while(Running() && !pollfd(m_fd, 100, true));
+
+    m_client = accept(m_fd, NULL, NULL);
+
+    while(Running()) {
+      bool closed = false;
+      MsgPacket* request = MsgPacket::read(m_client, closed, 100);
+
+      if(closed) {
+        break;
+      }
+
+      if(request == NULL) {
+        continue;
+      }
+
+      MsgPacket* response = Process(request);
+      Send(response);
+
+      delete response;
+      delete request;
+    }
+
+    closesocket(m_client);
+  }
+
+  MsgPacket* Process(MsgPacket* request) {
+    uint16_t msgid = request->getMsgID();
+    uint64_t length = GetLength();
+
+    MsgPacket* response = new MsgPacket(msgid, XVDR_CHANNEL_REQUEST_RESPONSE, request->getUID());
+
+    {
+      MutexLock lock(&m_lock);
+      m_requests[msgid & 0xFF]++;
+    }
+
+    switch(msgid) {
+      case XVDR_LOGIN:
+        response->put_U32(0);
+        response->put_S32(0);
+        response->put_String("recpolling");
+        response->put_String("1.0");
+        break;
+
+      case XVDR_RECSTREAM_OPEN:
+        response->put_U32(XVDR_RET_OK);
+        response->put_U32(0);
+        response->put_U64(length);
+        break;
+
+      case XVDR_RECSTREAM_UPDATE:
+        response->put_U32(0);
+        response->put_U64(length);
+        break;
+
+      case XVDR_RECSTREAM_GETBLOCK: {
+        uint64_t position = request->get_U64();
+        uint32_t size = request->get_U32();
+
+        if(position >= length) {
+          break;
+        }
+
+        if(position + size > length) {
+          size = (uint32_t)(length - position);
+        }
+
+        uint8_t* data = response->reserve(size);
+
+        for(uint32_t i = 0; i < size; i++) {
+          data[i] = pattern(position + i);
+        }
+        break;
+      }
+
+      default:
+        response->put_U32(XVDR_RET_OK);
+        break;
+    }
+
+    return response;
+  }
+
+private:
+
+  int m_fd;
+
+  int m_client;
+
+  uint64_t m_length;
+
+  int m_requests[256];
+
+  Mutex m_lock;
+};
+
+class PollingClient : public ConsoleClient {
+public:
+
+  // recordings list isn't needed
+  void TriggerRecordingUpdate() {}
+};
+
+// read up to the known end, returns the number of bytes read or -1 on error
+static int64_t ReadToEnd(PollingClient& client) {
+  static uint8_t buffer[readsize];
+  int64_t bytes = 0;
+
+  for(;;) {
+    uint64_t position = client.RecordingPosition();
+    int rc = client.ReadRecording(buffer, readsize);
+
+    if(rc == 0) {
+      return bytes;
+    }
+
+    if(rc < 0) {
+      client.Log(FAILURE, "Read failed at position %llu", (unsigned long long)position);
+      return -1;
+    }
+
+    for(int i = 0; i < rc; i++) {
+      if(buffer[i] != pattern(position + i)) {
+        client.Log(FAILURE, "Wrong data at position %llu", (unsigned long long)(position + i));
+        return -1;
+      }
+    }
+
+    bytes += rc;
+  }
+}
+
+static bool Check(PollingClient& client, bool condition, const char* message) {
+  client.Log(condition ? INFO : FAILURE, "%s: %s", condition ? "OK" : "FAILED", message);
+  return condition;
+}
+
+int main() {
+  RecordingServer server;
+  PollingClient client;
+  bool rc = true;
+
+  server.SetLength(16 * 1024 * 1024);
+
+  if(!server.Listen()) {
+    client.Log(FAILURE, "Unable to listen on port 34891 !");
+    return 1;
+  }
+
+  if(!client.Open("127.0.0.1", "Recording polling test") || !client.OpenRecording("1")) {
+    client.Log(FAILURE, "Unable to open recording !");
+    return 1;
+  }
+
+  // finished recording
+  server.ResetRequests();
+  int64_t bytes = ReadToEnd(client);
+  int reads = (int)(bytes / readsize);
+  int updates = server.GetRequests(XVDR_RECSTREAM_UPDATE);
+
+  client.Log(INFO, "finished recording: %lli bytes in %i reads, %i GETBLOCK and %i UPDATE requests", bytes, reads,
+    server.GetRequests(XVDR_RECSTREAM_GETBLOCK), updates);
+
+  rc = Check(client, bytes == (int64_t)server.GetLength(), "whole recording read") && rc;
+  rc = Check(client, updates <= 2, "length not polled on every read") && rc;
+
+  // the end stays the end
+  server.ResetRequests();
+  bytes = ReadToEnd(client) + ReadToEnd(client) + ReadToEnd(client);
+
+  rc = Check(client, bytes == 0 && server.GetRequests(XVDR_RECSTREAM_UPDATE) <= 1, "end of finished recording throttled") && rc;
+
+  // growth announced by the server
+  server.SetLength(24 * 1024 * 1024);
+  server.RecordingsChanged();
+  CondWait::SleepMs(100);
+
+  bytes = ReadToEnd(client);
+
+  rc = Check(client, bytes == 8 * 1024 * 1024, "announced growth detected") && rc;
+
+  // running recording, updated at the end without announcement
+  server.SetLength(28 * 1024 * 1024);
+  bytes = ReadToEnd(client);
+
+  rc = Check(client, bytes == 4 * 1024 * 1024, "growth of running recording detected") && rc;
+
+  client.CloseRecording();
+  client.Close();
+
+  return rc ? 0 : 1;
+}
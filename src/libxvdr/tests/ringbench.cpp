@@ -0,0 +1,165 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <deque>
+
+#include "xvdr/packetring.h"
+#include "xvdr/thread.h"
+
+using namespace XVDR;
+
+// handoff of live packets from the receiving thread to the reader
+struct Item {
+	uint32_t sequence;
+	void* data;
+};
+
+static const uint32_t count = 2000000;
+
+// the former live queue: deque protected by a mutex, signal on every packet
+class LockedQueue {
+public:
+
+	void push(const Item& item) {
+		MutexLock lock(&m_lock);
+		m_queue.push_back(item);
+		m_event.Signal();
+	}
+
+	bool pop(Item& item) {
+		MutexLock lock(&m_lock);
+
+		if(m_queue.empty()) {
+			return false;
+		}
+
+		item = m_queue.front();
+		m_queue.pop_front();
+		return true;
+	}
+
+	void wait() {
+		m_event.Wait(100);
+	}
+
+private:
+
+	std::deque<Item> m_queue;
+	Mutex m_lock;
+	CondWait m_event;
+};
+
+class LockFreeQueue {
+public:
+
+	void push(const Item& item) {
+		// the reader doesn't keep up, give it the cpu
+		while(!m_ring.push(item)) {
+			sched_yield();
+		}
+
+		m_ring.wakeup(m_event);
+	}
+
+	bool pop(Item& item) {
+		return m_ring.pop(item);
+	}
+
+	void wait() {
+		m_ring.wait(m_event, 100);
+	}
+
+private:
+
+	PacketRing<Item, 4096> m_ring;
+	CondWait m_event;
+};
+
+template<class Q>
+class Producer : public Thread {
+public:
+
+	Producer(Q& queue) : m_queue(queue) {
+	}
+
+protected:
+
+	void Action() {
+		for(uint32_t i = 0; i < count; i++) {
+			Item item = { i, NULL };
+			m_queue.push(item);
+		}
+	}
+
+private:
+
+	Q& m_queue;
+};
+
+template<class Q>
+static bool benchmark(const char* name) {
+	Q* queue = new Q;
+	Producer<Q> producer(*queue);
+	uint32_t expected = 0;
+
+	TimeMs t;
+	producer.Start();
+
+	while(expected < count) {
+		Item item;
+
+		if(!queue->pop(item)) {
+			queue->wait();
+			continue;
+		}
+
+		if(item.sequence != expected) {
+			printf("%s: sequence error (got %u expected %u)\n", name, item.sequence, expected);
+			return false;
+		}
+
+		expected++;
+	}
+
+	uint64_t elapsed = t.Elapsed();
+
+	while(producer.Active()) {
+		CondWait::SleepMs(1);
+	}
+
+	delete queue;
+
+	printf("%-12s %u packets in %4llu ms: %6.2f Mpkts/s\n", name, count, (unsigned long long)elapsed, (double)count / (double)(elapsed ? elapsed : 1) / 1000.0);
+	return true;
+}
+
+int main() {
+	bool rc = benchmark<LockedQueue>("mutex/deque");
+	rc = benchmark<LockFreeQueue>("spsc ring") && rc;
+
+	return rc ? 0 : 1;
+}
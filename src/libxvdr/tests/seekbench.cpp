@@ -0,0 +1,157 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <string>
+
+#include "xvdr/command.h"
+#include "xvdr/msgpacket.h"
+#include "xvdr/packetbuffer.h"
+
+using namespace XVDR;
+
+// synthetic channel: 25fps video (GOP of 12 frames) and two audio streams
+static const int duration = 2 * 60 * 60;
+static const int64_t frametime = 40000;
+static const int gopsize = 12;
+static const int64_t audiotime = 24000;
+static const int seeks = 2000;
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+}
+
+static void putpacket(PacketBuffer* buffer, uint16_t id, int64_t pts, uint16_t frametype) {
+	uint8_t payload[64];
+	memset(payload, 0, sizeof(payload));
+
+	MsgPacket* p = new MsgPacket(XVDR_STREAM_MUXPKT, XVDR_CHANNEL_STREAM);
+	p->setClientID(frametype);
+	p->put_U16(id);
+	p->put_S64(pts);
+	p->put_S64(pts);
+	p->put_U32(0);
+	p->put_U32(sizeof(payload));
+	p->put_Blob(payload, sizeof(payload));
+
+	buffer->put(p);
+}
+
+static int fill(PacketBuffer* buffer) {
+	int64_t end = (int64_t)duration * 1000000;
+	int64_t audio = 0;
+	int count = 0;
+
+	for(int64_t pts = 0, frame = 0; pts < end; pts += frametime, frame++) {
+		putpacket(buffer, 100, pts, (frame % gopsize == 0) ? 1 : 2 + (frame % 3 != 0));
+		count++;
+
+		while(audio <= pts) {
+			putpacket(buffer, 101, audio, 0);
+			putpacket(buffer, 102, audio, 0);
+			audio += audiotime;
+			count += 2;
+		}
+	}
+
+	return count;
+}
+
+static bool benchmark(const char* name, PacketBuffer* buffer) {
+	if(buffer == NULL) {
+		printf("%-6s unable to create the buffer\n", name);
+		return false;
+	}
+
+	double t = now();
+	int count = fill(buffer);
+	double filltime = now() - t;
+
+	printf("%-6s %i packets (%i minutes, %.1f MB) buffered in %.2f s\n", name, count, duration / 60, (double)buffer->size() / (1024.0 * 1024.0), filltime);
+
+	srand(42);
+
+	int64_t position = 0;
+	double total = 0;
+	double max = 0;
+
+	for(int i = 0; i < seeks; i++) {
+		int time = rand() % (duration * 1000);
+		bool backwards = ((int64_t)time * 1000 < position);
+		double startpts = 0;
+
+		t = now();
+		bool rc = buffer->seek(time, backwards, &startpts);
+		double elapsed = now() - t;
+
+		// the jump destination has to be the keyframe next to the requested time
+		int64_t distance = backwards ? (int64_t)time * 1000 - (int64_t)startpts : (int64_t)startpts - (int64_t)time * 1000;
+
+		if(!rc || distance < 0 || distance >= frametime * gopsize) {
+			printf("%-6s seek to %i ms (%s) failed: %s, start pts %.0f\n", name, time, backwards ? "backwards" : "forward", rc ? "wrong position" : "not found", startpts);
+			return false;
+		}
+
+		position = (int64_t)startpts;
+		total += elapsed;
+
+		if(elapsed > max) {
+			max = elapsed;
+		}
+	}
+
+	printf("%-6s %i seeks: avg %.1f us, max %.1f us\n", name, seeks, total * 1000000.0 / seeks, max * 1000000.0);
+
+	PacketBuffer::Statistics stats;
+	buffer->getStatistics(stats);
+
+	if(stats.writes > 0) {
+		printf("%-6s %llu writes (%.1f MB): avg %llu us, max %llu us, queue max %u packets, %llu stalls\n", name,
+			(unsigned long long)stats.writes, (double)stats.written / (1024.0 * 1024.0), (unsigned long long)(stats.latency / stats.writes),
+			(unsigned long long)stats.maxlatency, (unsigned int)stats.maxqueued, (unsigned long long)stats.stalls);
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	size_t maxsize = (size_t)512 * 1024 * 1024;
+
+	PacketBuffer* buffer = PacketBuffer::create(maxsize);
+	bool rc = benchmark("memory", buffer);
+	delete buffer;
+
+	// optional disk buffer (filename of the buffer file)
+	if(argc >= 2) {
+		buffer = PacketBuffer::create(maxsize, argv[1]);
+		rc = benchmark("disk", buffer) && rc;
+		delete buffer;
+	}
+
+	return rc ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+/*
+ *      xbmc-addon-xvdr - XVDR addon for XBMC
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/xbmc-addon-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+#include "consoleclient.h"
+#include "xvdr/demux.h"
+#include "xvdr/demuxpool.h"
+
+using namespace XVDR;
+
+struct ZapStats {
+  int count;
+  int failed;
+  uint64_t min;
+  uint64_t max;
+  uint64_t sum;
+};
+
+static void AddSample(ZapStats& s, uint64_t ms) {
+  if(s.count == 0 || ms < s.min) {
+    s.min = ms;
+  }
+  if(ms > s.max) {
+    s.max = ms;
+  }
+
+  s.sum += ms;
+  s.count++;
+}
+
+static bool WaitFirstPacket(ConsoleClient& client, Demux* demux, int timeout) {
+  TimeMs t;
+
+  while(t.Elapsed() < (uint64_t)timeout) {
+    ConsoleClient::Packet* p = demux->Read<ConsoleClient::Packet>(timeout - (int)t.Elapsed());
+
+    if(p == NULL) {
+      return false;
+    }
+
+    bool data = (p->data != NULL);
+    client.FreePacket(p);
+
+    if(data) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void PrintStats(ConsoleClient& client, const char* name, ZapStats& s) {
+  if(s.count == 0) {
+    client.Log(INFO, "%-8s no successful zaps (%i failed)", name, s.failed);
+    return;
+  }
+
+  client.Log(INFO, "%-8s %3i zaps  min: %4llu ms  avg: %4llu ms  max: %4llu ms  (%i failed)", name, s.count,
+    (unsigned long long)s.min, (unsigned long long)(s.sum / s.count), (unsigned long long)s.max, s.failed);
+}
+
+int main(int argc, char* argv[]) {
+  std::string hostname = "192.168.16.10";
+  int zaps = 10;
+  int dwell = 1000;
+
+  if(argc >= 2) {
+    hostname = argv[1];
+  }
+  if(argc >= 3) {
+    zaps = atoi(argv[2]);
+  }
+  if(argc >= 4) {
+    dwell = atoi(argv[3]);
+  }
+
+  ConsoleClient client;
+
+  if(!client.Open(hostname, "Zap benchmark client")) {
+    client.Log(FAILURE,"Unable to open connection !");
+    return 1;
+  }
+
+  client.GetChannelsList();
+
+  if(client.m_channels.empty()) {
+    client.Log(FAILURE, "No channels available !");
+    return 1;
+  }
+
+  client.Log(INFO, "Zapping %i times through %i channels (%i ms per channel) ..", zaps, client.m_channels.size(), dwell);
+
+  ZapStats cold = ZapStats();
+  ZapStats warm = ZapStats();
+  ZapStats coldclose = ZapStats();
+  ZapStats warmclose = ZapStats();
+  Demux* demux = NULL;
+
+  // new connection on every zap
+  for(int i = 0; i < zaps; i++) {
+    Channel& c = client.m_channels[i % client.m_channels.size()];
+    TimeMs t;
+
+    if(demux != NULL) {
+      demux->Close();
+      delete demux;
+      AddSample(coldclose, t.Elapsed());
+    }
+
+    demux = new Demux(&client);
+
+    if(demux->OpenChannel(hostname, c.UID) == Demux::SC_OK && WaitFirstPacket(client, demux, 5000)) {
+      AddSample(cold, t.Elapsed());
+    }
+    else {
+      cold.failed++;
+    }
+
+    CondWait::SleepMs(dwell);
+  }
+
+  demux->Close();
+  delete demux;
+  demux = NULL;
+
+  // standby demuxer
+  DemuxPool pool(&client);
+  pool.Open(hostname);
+
+  while(pool.GetStandbyCount() == 0) {
+    CondWait::SleepMs(10);
+  }
+
+  for(int i = 0; i < zaps; i++) {
+    Channel& c = client.m_channels[i % client.m_channels.size()];
+    TimeMs t;
+
+    if(demux != NULL) {
+      pool.Release(demux);
+      AddSample(warmclose, t.Elapsed());
+    }
+
+    demux = pool.Claim();
+
+    Demux::SwitchStatus status;
+
+    if(demux == NULL) {
+      client.Log(INFO, "no standby demuxer ready");
+      demux = new Demux(&client);
+      status = demux->OpenChannel(hostname, c.UID);
+    }
+    else {
+      status = demux->SwitchChannel(c.UID);
+    }
+
+    if(status == Demux::SC_OK && WaitFirstPacket(client, demux, 5000)) {
+      AddSample(warm, t.Elapsed());
+    }
+    else {
+      warm.failed++;
+    }
+
+    CondWait::SleepMs(dwell);
+  }
+
+  pool.Release(demux);
+  pool.Close();
+
+  client.Log(INFO, "");
+  client.Log(INFO, "Zap time to first packet:");
+  PrintStats(client, "connect", cold);
+  PrintStats(client, "standby", warm);
+  client.Log(INFO, "Time to close the previous channel:");
+  PrintStats(client, "delete", coldclose);
+  PrintStats(client, "release", warmclose);
+
+  client.Close();
+
+  return 0;
+}
@@ -28,6 +28,7 @@
 #include "XBMCSettings.h"
 
 #include "xvdr/demux.h"
+#include "xvdr/demuxpool.h"
 #include "xvdr/command.h"
 #include "xvdr/connection.h"
 #include "xvdr/packetbuffer.h"
@@ -52,6 +53,7 @@ CHelper_libXBMC_pvr* PVR = NULL;
 CHelper_libXBMC_codec* CODEC = NULL;
 
 Demux* mDemuxer = NULL;
+DemuxPool* mDemuxPool = NULL;
 cXBMCClient *mClient = NULL;
 XVDR::Mutex addonMutex;
 
@@ -59,6 +61,22 @@ int CurrentChannel = 0;
 
 static int priotable[] = { 0,5,10,15,20,25,30,35,40,45,50,55,60,65,70,75,80,85,90,95,99,100 };
 
+static void SetRecordingCache(cXBMCSettings& s) {
+  std::string cachefile = s.TSFolder();
+
+  // use temp folder if tsfolder is empty
+  if(cachefile.empty()) {
+    XVDR::ClientInterface::GetTempFolder(cachefile);
+  }
+
+  XVDR::ClientInterface::TrimPath(cachefile, true);
+  cachefile += "xvdr-recordings.cache";
+
+  if(!mClient->SetRecordingCache(s.RecCacheSize() * 1024 * 1024, s.RecCacheSizeHDD() * 1024 * 1024, cachefile)) {
+    XBMC->Log(LOG_NOTICE, "unable to create recording cache at '%s'", cachefile.c_str());
+  }
+}
+
 void ADDON_Cleanup() {
   delete GUI;
   delete PVR;
@@ -116,7 +134,9 @@ ADDON_STATUS ADDON_Create(void* hdl, void* props)
   mClient = new cXBMCClient;
   mClient->SetTimeout(s.ConnectTimeout() * 1000);
   mClient->SetCompressionLevel(s.Compression() * 3);
+  mClient->SetCompressionCodec(s.CompressionCodec());
   mClient->SetAudioType(s.AudioType());
+  SetRecordingCache(s);
 
   TimeMs RetryTimeout;
   bool bConnected = false;
@@ -147,6 +167,12 @@ ADDON_STATUS ADDON_Create(void* hdl, void* props)
     PVR->AddMenuHook(&hook);
   }
 
+  // keep a logged-in demuxer ready for fast channel switches
+  mDemuxPool = new DemuxPool(mClient);
+  mDemuxPool->SetTimeout(s.ConnectTimeout() * 1000);
+  mDemuxPool->SetAudioType(s.AudioType());
+  mDemuxPool->Open(s.Hostname(), s.ClientName());
+
   return ADDON_STATUS_OK;
 }
 
@@ -159,6 +185,9 @@ void ADDON_Destroy()
 {
   XVDR::MutexLock lock(&addonMutex);
 
+  delete mDemuxPool;
+  mDemuxPool = NULL;
+
   delete mClient;
   mClient = NULL;
 
@@ -193,8 +222,18 @@ ADDON_STATUS ADDON_SetSetting(const char *settingName, const void *settingValue)
 
   mClient->SetTimeout(s.ConnectTimeout() * 1000);
   mClient->SetCompressionLevel(s.Compression() * 3);
+  mClient->SetCompressionCodec(s.CompressionCodec());
   mClient->SetAudioType(s.AudioType());
 
+  // resizing drops the cached blocks
+  if(strcmp(settingName, "reccachesize") == 0 || strcmp(settingName, "reccachesizehdd") == 0 || strcmp(settingName, "tsfolder") == 0)
+    SetRecordingCache(s);
+
+  if(mDemuxPool != NULL) {
+    mDemuxPool->SetTimeout(s.ConnectTimeout() * 1000);
+    mDemuxPool->SetAudioType(s.AudioType());
+  }
+
   if(!bChanged)
     return ADDON_STATUS_OK;
 
@@ -526,17 +565,32 @@ void ChannelNotification(Demux::SwitchStatus status)
   }
 }
 
-bool OpenLiveStream(const PVR_CHANNEL &channel)
+static void ReleaseDemuxer()
 {
-  mClient->Lock();
+  if (!mDemuxer)
+    return;
 
-  if (mDemuxer)
-  {
+  // the timeshift file can't be shared with the old demuxer,
+  // it has to be gone before the next one is created
+  if(cXBMCSettings::GetInstance().TSMethod() == 2 || mDemuxPool == NULL) {
     mDemuxer->Close();
     delete mDemuxer;
   }
+  else {
+    mDemuxPool->Release(mDemuxer);
+  }
+
+  mDemuxer = NULL;
+}
+
+bool OpenLiveStream(const PVR_CHANNEL &channel)
+{
+  mClient->Lock();
 
   cXBMCSettings& s = cXBMCSettings::GetInstance();
+
+  ReleaseDemuxer();
+
   PacketBuffer* buf = NULL;
 
   // simple timeshift
@@ -550,6 +604,9 @@ bool OpenLiveStream(const PVR_CHANNEL &channel)
     if(buf != NULL) {
       XBMC->Log(LOG_NOTICE, "doing timeshift in memory using %f Mb RAM", s.TSBufferSize());
     }
+    else if(s.TSBufferSize() > 0) {
+      XBMC->Log(LOG_ERROR, "unable to allocate %f Mb RAM for timeshift, using live mode", s.TSBufferSize());
+    }
   }
 
   // full-timeshift (hdd)
@@ -568,9 +625,18 @@ bool OpenLiveStream(const PVR_CHANNEL &channel)
     if(buf != NULL) {
       XBMC->Log(LOG_NOTICE, "doing timeshift on hdd at '%s' using %f Mb", tsfile.c_str(), s.TSBufferSizeHDD());
     }
+    else if(s.TSBufferSizeHDD() > 0) {
+      XBMC->Log(LOG_ERROR, "unable to create timeshift file '%s' (%f Mb), using live mode", tsfile.c_str(), s.TSBufferSizeHDD());
+    }
+  }
+
+  // use a standby demuxer if available
+  bool standby = (mDemuxPool != NULL && (mDemuxer = mDemuxPool->Claim(buf)) != NULL);
+
+  if(!standby) {
+    mDemuxer = new Demux(mClient, buf);
   }
 
-  mDemuxer = new Demux(mClient, buf);
   mDemuxer->SetTimeout(cXBMCSettings::GetInstance().ConnectTimeout() * 1000);
   mDemuxer->SetAudioType(cXBMCSettings::GetInstance().AudioType());
   mDemuxer->SetPriority(priotable[cXBMCSettings::GetInstance().Priority()]);
@@ -579,8 +645,14 @@ bool OpenLiveStream(const PVR_CHANNEL &channel)
     mDemuxer->SetStartWithIFrame(cXBMCSettings::GetInstance().StartWithIFrame());
   }
 
-  const cXBMCSettings& settings = cXBMCSettings::GetInstance();
-  Demux::SwitchStatus status = mDemuxer->OpenChannel(settings.Hostname(), channel.iUniqueId, settings.ClientName());
+  Demux::SwitchStatus status;
+
+  if(standby) {
+    status = mDemuxer->SwitchChannel(channel.iUniqueId);
+  }
+  else {
+    status = mDemuxer->OpenChannel(s.Hostname(), channel.iUniqueId, s.ClientName());
+  }
 
   if (status == Demux::SC_OK)
     CurrentChannel = channel.iChannelNumber;
@@ -595,14 +667,7 @@ bool OpenLiveStream(const PVR_CHANNEL &channel)
 void CloseLiveStream(void)
 {
   mClient->Lock();
-
-  if (mDemuxer)
-  {
-    mDemuxer->Close();
-    delete mDemuxer;
-    mDemuxer = NULL;
-  }
-
+  ReleaseDemuxer();
   mClient->Unlock();
 }
 
@@ -279,6 +279,11 @@ void cXBMCClient::FreePacket(Packet* packet)
   PVR->FreeDemuxPacket((DemuxPacket*)packet);
 }
 
+uint8_t* cXBMCClient::GetPacketBuffer(Packet* packet)
+{
+  return static_cast<DemuxPacket*>(packet)->pData;
+}
+
 Packet* cXBMCClient::StreamChange(const StreamProperties& p) {
   Packet* pkt = AllocatePacket(0);
   if (pkt != NULL)
@@ -90,6 +90,8 @@ public:
 
   void FreePacket(XVDR::Packet* packet);
 
+  uint8_t* GetPacketBuffer(XVDR::Packet* packet);
+
   XVDR::Packet* StreamChange(const XVDR::StreamProperties& p);
 
   XVDR::Packet* ContentInfo(const XVDR::StreamProperties& p);
@@ -128,6 +128,7 @@ public:
   cXBMCConfigParameter<bool> HandleMessages;
   cXBMCConfigParameter<int> Priority;
   cXBMCConfigParameter<int> Compression;
+  cXBMCConfigParameter<int> CompressionCodec;
   cXBMCConfigParameter<bool> AutoChannelGroups;
   cXBMCConfigParameter<int> AudioType;
   cXBMCConfigParameter<int> UpdateChannels;
@@ -141,6 +142,8 @@ public:
   cXBMCConfigParameter<float> TSBufferSizeHDD;
   cXBMCConfigParameter<int> TSMethod;
   cXBMCConfigParameter<std::string> TSFolder;
+  cXBMCConfigParameter<float> RecCacheSize;
+  cXBMCConfigParameter<float> RecCacheSizeHDD;
   cXBMCConfigParameter<std::string> ClientName;
   std::vector<int> vcaids;
 
@@ -152,6 +155,7 @@ protected:
   HandleMessages("handlemessages", true),
   Priority("priority", 50),
   Compression("compression", 2),
+  CompressionCodec("compressioncodec", 0),
   AutoChannelGroups("autochannelgroups", false),
   AudioType("audiotype", 0),
   UpdateChannels("updatechannels", 3),
@@ -165,6 +169,8 @@ protected:
   TSMethod("tsmethod"),
   TSBufferSizeHDD("tsbuffersizehdd"),
   TSFolder("tsfolder"),
+  RecCacheSize("reccachesize", 32),
+  RecCacheSizeHDD("reccachesizehdd", 0),
   ClientName("clientname")
   {}
 